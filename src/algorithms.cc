@@ -1,23 +1,754 @@
 /* algorithms.cc */
+#include <array>
+#include <cmath>
+#include <type_traits>
 #include "algorithms.hh"
 #include "fractal.hh"
-#include "complex.hh"
+#include "functions.hh"
 #include "const.h"
 
-int mandelbrot(long double x, long double y, int iterations, ComplexLf *r)
+#if defined(__x86_64__) || defined(__i386__)
+#define ALGORITHMS_X86
+#include <immintrin.h>
+#endif
+
+/* Points inside the main cardioid or the period 2 bulb never escape,
+ * which is cheap to test for analytically. Evaluates to the period of the
+ * component the point lies in, 0 if it lies in neither
+ */
+int mandelbrot_interior(long double x, long double y)
+{
+	long double const xq = x - 0.25L;
+	long double const q  = xq * xq + y * y;
+
+	if(q * (q + xq) <= 0.25L * y * y)
+		return 1;
+	if((x + 1.0L) * (x + 1.0L) + y * y <= 0.0625L)
+		return 2;
+	return 0;
+}
+
+/* Kernels are written once for every formula (see functions.hh) and
+ * every number type, on lanes of an instruction set that run a pixel
+ * each. The scalar lanes run a single one, of any type. The kernels spell
+ * out every operation, they lose nothing to strict IEEE arithmetic, which
+ * the double-double kernels rely on
+ */
+#pragma GCC push_options
+#pragma GCC optimize("no-fast-math")
+
+/* The lanes of an instruction set for a number type: the vector and mask
+ * types, the amount of lanes and the operations the kernel is made of.
+ * blend() takes b where the mask is set and a elsewhere, clear() clears
+ * the lanes of b from a. Only the fused double lanes have fmsub(), which
+ * the double-double kernels need to be exact
+ */
+template <typename N>
+struct Scalar
+{
+	typedef N    T;
+	typedef N    V;
+	typedef bool M;
+	static int const width = 1;
+
+	static inline V    set1(T a)               { return a; }
+	static inline V    load(T const *p)        { return *p; }
+	static inline void store(T *p, V a)        { *p = a; }
+	static inline V    add(V a, V b)           { return a + b; }
+	static inline V    sub(V a, V b)           { return a - b; }
+	static inline V    mul(V a, V b)           { return a * b; }
+	static inline V    div(V a, V b)           { return a / b; }
+	static inline V    abs(V a)                { return std::fabs(a); }
+	static inline V    fmadd(V a, V b, V c)    { return a * b + c; }
+	static inline V    fmsub(V a, V b, V c)    { return std::fma(a, b, -c); }
+	static inline M    eq(V a, V b)            { return a == b; }
+	static inline M    lt(V a, V b)            { return a < b; }
+	static inline M    ge(V a, V b)            { return a >= b; }
+	static inline M    both(M a, M b)          { return a && b; }
+	static inline M    clear(M a, M b)         { return a && !b; }
+	static inline V    blend(V a, V b, M mask) { return mask ? b : a; }
+	static inline bool any(M mask)             { return mask; }
+};
+
+#ifdef ALGORITHMS_X86
+#define TARGET_AVX2   __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+
+/* Vectors only ever cross function boundaries where the lanes below are
+ * inlined into the kernels of their instruction set, so their ABI
+ * warnings are left out from here to the end of the kernels
+ */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+template <typename T> struct Sse2;
+template <typename T> struct Avx2;
+template <typename T> struct Avx512;
+
+template <>
+struct Sse2<double>
+{
+	typedef double  T;
+	typedef __m128d V;
+	typedef __m128d M;
+	static int const width = 2;
+
+	static inline V    set1(T a)               { return _mm_set1_pd(a); }
+	static inline V    load(T const *p)        { return _mm_loadu_pd(p); }
+	static inline void store(T *p, V a)        { _mm_storeu_pd(p, a); }
+	static inline V    add(V a, V b)           { return _mm_add_pd(a, b); }
+	static inline V    sub(V a, V b)           { return _mm_sub_pd(a, b); }
+	static inline V    mul(V a, V b)           { return _mm_mul_pd(a, b); }
+	static inline V    div(V a, V b)           { return _mm_div_pd(a, b); }
+	static inline V    abs(V a)                { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+	static inline V    fmadd(V a, V b, V c)    { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+	static inline M    eq(V a, V b)            { return _mm_cmpeq_pd(a, b); }
+	static inline M    lt(V a, V b)            { return _mm_cmplt_pd(a, b); }
+	static inline M    ge(V a, V b)            { return _mm_cmpge_pd(a, b); }
+	static inline M    both(M a, M b)          { return _mm_and_pd(a, b); }
+	static inline M    clear(M a, M b)         { return _mm_andnot_pd(b, a); }
+	static inline V    blend(V a, V b, M mask) { return _mm_or_pd(_mm_and_pd(mask, b), _mm_andnot_pd(mask, a)); }
+	static inline bool any(M mask)             { return _mm_movemask_pd(mask) != 0; }
+};
+
+template <>
+struct Sse2<float>
+{
+	typedef float  T;
+	typedef __m128 V;
+	typedef __m128 M;
+	static int const width = 4;
+
+	static inline V    set1(T a)               { return _mm_set1_ps(a); }
+	static inline V    load(T const *p)        { return _mm_loadu_ps(p); }
+	static inline void store(T *p, V a)        { _mm_storeu_ps(p, a); }
+	static inline V    add(V a, V b)           { return _mm_add_ps(a, b); }
+	static inline V    sub(V a, V b)           { return _mm_sub_ps(a, b); }
+	static inline V    mul(V a, V b)           { return _mm_mul_ps(a, b); }
+	static inline V    div(V a, V b)           { return _mm_div_ps(a, b); }
+	static inline V    abs(V a)                { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+	static inline V    fmadd(V a, V b, V c)    { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+	static inline M    eq(V a, V b)            { return _mm_cmpeq_ps(a, b); }
+	static inline M    lt(V a, V b)            { return _mm_cmplt_ps(a, b); }
+	static inline M    ge(V a, V b)            { return _mm_cmpge_ps(a, b); }
+	static inline M    both(M a, M b)          { return _mm_and_ps(a, b); }
+	static inline M    clear(M a, M b)         { return _mm_andnot_ps(b, a); }
+	static inline V    blend(V a, V b, M mask) { return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a)); }
+	static inline bool any(M mask)             { return _mm_movemask_ps(mask) != 0; }
+};
+
+template <>
+struct Avx2<double>
+{
+	typedef double  T;
+	typedef __m256d V;
+	typedef __m256d M;
+	static int const width = 4;
+
+	TARGET_AVX2 static inline V    set1(T a)               { return _mm256_set1_pd(a); }
+	TARGET_AVX2 static inline V    load(T const *p)        { return _mm256_loadu_pd(p); }
+	TARGET_AVX2 static inline void store(T *p, V a)        { _mm256_storeu_pd(p, a); }
+	TARGET_AVX2 static inline V    add(V a, V b)           { return _mm256_add_pd(a, b); }
+	TARGET_AVX2 static inline V    sub(V a, V b)           { return _mm256_sub_pd(a, b); }
+	TARGET_AVX2 static inline V    mul(V a, V b)           { return _mm256_mul_pd(a, b); }
+	TARGET_AVX2 static inline V    div(V a, V b)           { return _mm256_div_pd(a, b); }
+	TARGET_AVX2 static inline V    abs(V a)                { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+	TARGET_AVX2 static inline V    fmadd(V a, V b, V c)    { return _mm256_fmadd_pd(a, b, c); }
+	TARGET_AVX2 static inline V    fmsub(V a, V b, V c)    { return _mm256_fmsub_pd(a, b, c); }
+	TARGET_AVX2 static inline M    eq(V a, V b)            { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+	TARGET_AVX2 static inline M    lt(V a, V b)            { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+	TARGET_AVX2 static inline M    ge(V a, V b)            { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+	TARGET_AVX2 static inline M    both(M a, M b)          { return _mm256_and_pd(a, b); }
+	TARGET_AVX2 static inline M    clear(M a, M b)         { return _mm256_andnot_pd(b, a); }
+	TARGET_AVX2 static inline V    blend(V a, V b, M mask) { return _mm256_blendv_pd(a, b, mask); }
+	TARGET_AVX2 static inline bool any(M mask)             { return !_mm256_testz_pd(mask, mask); }
+};
+
+template <>
+struct Avx2<float>
+{
+	typedef float  T;
+	typedef __m256 V;
+	typedef __m256 M;
+	static int const width = 8;
+
+	TARGET_AVX2 static inline V    set1(T a)               { return _mm256_set1_ps(a); }
+	TARGET_AVX2 static inline V    load(T const *p)        { return _mm256_loadu_ps(p); }
+	TARGET_AVX2 static inline void store(T *p, V a)        { _mm256_storeu_ps(p, a); }
+	TARGET_AVX2 static inline V    add(V a, V b)           { return _mm256_add_ps(a, b); }
+	TARGET_AVX2 static inline V    sub(V a, V b)           { return _mm256_sub_ps(a, b); }
+	TARGET_AVX2 static inline V    mul(V a, V b)           { return _mm256_mul_ps(a, b); }
+	TARGET_AVX2 static inline V    div(V a, V b)           { return _mm256_div_ps(a, b); }
+	TARGET_AVX2 static inline V    abs(V a)                { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+	TARGET_AVX2 static inline V    fmadd(V a, V b, V c)    { return _mm256_fmadd_ps(a, b, c); }
+	TARGET_AVX2 static inline M    eq(V a, V b)            { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+	TARGET_AVX2 static inline M    lt(V a, V b)            { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	TARGET_AVX2 static inline M    ge(V a, V b)            { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+	TARGET_AVX2 static inline M    both(M a, M b)          { return _mm256_and_ps(a, b); }
+	TARGET_AVX2 static inline M    clear(M a, M b)         { return _mm256_andnot_ps(b, a); }
+	TARGET_AVX2 static inline V    blend(V a, V b, M mask) { return _mm256_blendv_ps(a, b, mask); }
+	TARGET_AVX2 static inline bool any(M mask)             { return !_mm256_testz_ps(mask, mask); }
+};
+
+template <>
+struct Avx512<double>
+{
+	typedef double   T;
+	typedef __m512d  V;
+	typedef __mmask8 M;
+	static int const width = 8;
+
+	TARGET_AVX512 static inline V    set1(T a)               { return _mm512_set1_pd(a); }
+	TARGET_AVX512 static inline V    load(T const *p)        { return _mm512_loadu_pd(p); }
+	TARGET_AVX512 static inline void store(T *p, V a)        { _mm512_storeu_pd(p, a); }
+	TARGET_AVX512 static inline V    add(V a, V b)           { return _mm512_add_pd(a, b); }
+	TARGET_AVX512 static inline V    sub(V a, V b)           { return _mm512_sub_pd(a, b); }
+	TARGET_AVX512 static inline V    mul(V a, V b)           { return _mm512_mul_pd(a, b); }
+	TARGET_AVX512 static inline V    div(V a, V b)           { return _mm512_div_pd(a, b); }
+	TARGET_AVX512 static inline V    abs(V a)                { return _mm512_abs_pd(a); }
+	TARGET_AVX512 static inline V    fmadd(V a, V b, V c)    { return _mm512_fmadd_pd(a, b, c); }
+	TARGET_AVX512 static inline V    fmsub(V a, V b, V c)    { return _mm512_fmsub_pd(a, b, c); }
+	TARGET_AVX512 static inline M    eq(V a, V b)            { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+	TARGET_AVX512 static inline M    lt(V a, V b)            { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+	TARGET_AVX512 static inline M    ge(V a, V b)            { return _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ); }
+	TARGET_AVX512 static inline M    both(M a, M b)          { return a & b; }
+	TARGET_AVX512 static inline M    clear(M a, M b)         { return a & ~b; }
+	TARGET_AVX512 static inline V    blend(V a, V b, M mask) { return _mm512_mask_mov_pd(a, mask, b); }
+	TARGET_AVX512 static inline bool any(M mask)             { return mask != 0; }
+};
+
+template <>
+struct Avx512<float>
+{
+	typedef float     T;
+	typedef __m512    V;
+	typedef __mmask16 M;
+	static int const width = 16;
+
+	TARGET_AVX512 static inline V    set1(T a)               { return _mm512_set1_ps(a); }
+	TARGET_AVX512 static inline V    load(T const *p)        { return _mm512_loadu_ps(p); }
+	TARGET_AVX512 static inline void store(T *p, V a)        { _mm512_storeu_ps(p, a); }
+	TARGET_AVX512 static inline V    add(V a, V b)           { return _mm512_add_ps(a, b); }
+	TARGET_AVX512 static inline V    sub(V a, V b)           { return _mm512_sub_ps(a, b); }
+	TARGET_AVX512 static inline V    mul(V a, V b)           { return _mm512_mul_ps(a, b); }
+	TARGET_AVX512 static inline V    div(V a, V b)           { return _mm512_div_ps(a, b); }
+	TARGET_AVX512 static inline V    abs(V a)                { return _mm512_abs_ps(a); }
+	TARGET_AVX512 static inline V    fmadd(V a, V b, V c)    { return _mm512_fmadd_ps(a, b, c); }
+	TARGET_AVX512 static inline M    eq(V a, V b)            { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+	TARGET_AVX512 static inline M    lt(V a, V b)            { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+	TARGET_AVX512 static inline M    ge(V a, V b)            { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+	TARGET_AVX512 static inline M    both(M a, M b)          { return a & b; }
+	TARGET_AVX512 static inline M    clear(M a, M b)         { return a & ~b; }
+	TARGET_AVX512 static inline V    blend(V a, V b, M mask) { return _mm512_mask_mov_ps(a, mask, b); }
+	TARGET_AVX512 static inline bool any(M mask)             { return mask != 0; }
+};
+
+#endif
+
+/* Double-double numbers on lanes, as a vector of high parts and one of
+ * low parts, with the same transforms as DoubleDouble
+ */
+template <typename L>
+struct Pair
+{
+	typename L::V hi, lo;
+};
+
+template <typename L>
+static inline Pair<L> pair_add(Pair<L> a, Pair<L> b)
 {
-	ComplexLf z{0, 0};
-	ComplexLf c{x, y};
+	typedef typename L::V V;
 
-	int iter = 0;
-	while(iter < iterations && z.norm() < 4.0L)
+	V const s = L::add(a.hi, b.hi);
+	V const v = L::sub(s, a.hi);
+	V const e = L::add(L::add(L::sub(a.hi, L::sub(s, v)), L::sub(b.hi, v)), L::add(a.lo, b.lo));
+	V const h = L::add(s, e);
+	return {h, L::sub(e, L::sub(h, s))};
+}
+
+template <typename L>
+static inline Pair<L> pair_sub(Pair<L> a, Pair<L> b)
+{
+	typedef typename L::V V;
+
+	V const s = L::sub(a.hi, b.hi);
+	V const v = L::sub(s, a.hi);
+	V const e = L::add(L::sub(L::sub(a.hi, L::sub(s, v)), L::add(b.hi, v)), L::sub(a.lo, b.lo));
+	V const h = L::add(s, e);
+	return {h, L::sub(e, L::sub(h, s))};
+}
+
+template <typename L>
+static inline Pair<L> pair_mul(Pair<L> a, Pair<L> b)
+{
+	typedef typename L::V V;
+
+	V const p = L::mul(a.hi, b.hi);
+	V const e = L::fmadd(a.lo, b.hi, L::fmadd(a.hi, b.lo, L::fmsub(a.hi, b.hi, p)));
+	V const h = L::add(p, e);
+	return {h, L::sub(e, L::sub(h, p))};
+}
+
+template <typename L>
+static inline Pair<L> pair_square(Pair<L> a)
+{
+	typedef typename L::V V;
+
+	V const p = L::mul(a.hi, a.hi);
+	V const e = L::fmadd(L::add(a.hi, a.hi), a.lo, L::fmsub(a.hi, a.hi, p));
+	V const h = L::add(p, e);
+	return {h, L::sub(e, L::sub(h, p))};
+}
+
+/* One Newton step from the double quotient, as DoubleDouble::divide()
+ */
+template <typename L>
+static inline Pair<L> pair_div(Pair<L> a, Pair<L> b)
+{
+	typedef typename L::V V;
+
+	V const       q = L::div(a.hi, b.hi);
+	Pair<L> const r = pair_sub(a, pair_mul(b, {q, L::set1(0)}));
+	V const       e = L::div(r.hi, b.hi);
+	V const       h = L::add(q, e);
+	return {h, L::sub(e, L::sub(h, q))};
+}
+
+template <typename L>
+static inline Pair<L> pair_abs(Pair<L> a)
+{
+	typename L::M const negative = L::lt(a.hi, L::set1(0));
+	return {L::blend(a.hi, L::sub(L::set1(0), a.hi), negative), L::blend(a.lo, L::sub(L::set1(0), a.lo), negative)};
+}
+
+/* The arithmetic the formulas are written against, on numbers of the
+ * lanes themselves. gather() loads the lanes from pixel i of n on, the
+ * lanes past the last pixel repeat it. lead() is the number as a lane
+ * vector, which the escape and cycle tests are made on
+ */
+template <typename L>
+struct Plain
+{
+	typedef L             Lanes;
+	typedef typename L::T T;
+	typedef typename L::V V;
+
+	static inline V gather(T const *p, int i, int n)
+	{
+		T lanes[L::width];
+		for(int k = 0; k < L::width; ++k)
+			lanes[k] = p[i + k < n ? i + k : n - 1];
+		return L::load(lanes);
+	}
+
+	static inline V    set1(double a)                      { return L::set1(a); }
+	static inline V    add(V a, V b)                       { return L::add(a, b); }
+	static inline V    sub(V a, V b)                       { return L::sub(a, b); }
+	static inline V    mul(V a, V b)                       { return L::mul(a, b); }
+	static inline V    div(V a, V b)                       { return L::div(a, b); }
+	static inline V    abs(V a)                            { return L::abs(a); }
+	static inline V    twice(V a)                          { return L::add(a, a); }
+	static inline V    square(V a)                         { return L::mul(a, a); }
+	static inline V    fmadd(V a, V b, V c)                { return L::fmadd(a, b, c); }
+	static inline V    blend(V a, V b, typename L::M mask) { return L::blend(a, b, mask); }
+	static inline V    lead(V a)                           { return a; }
+};
+
+/* The same arithmetic on double-double pairs of double lanes. Escape and
+ * cycle tests only need the high parts
+ */
+template <typename L>
+struct Pairs
+{
+	typedef L            Lanes;
+	typedef DoubleDouble T;
+	typedef Pair<L>      V;
+
+	static inline V gather(T const *p, int i, int n)
 	{
-		z = z.square() + c;
-		iter++;
+		double hi[L::width], lo[L::width];
+		for(int k = 0; k < L::width; ++k)
+		{
+			hi[k] = p[i + k < n ? i + k : n - 1].hi();
+			lo[k] = p[i + k < n ? i + k : n - 1].lo();
+		}
+		return {L::load(hi), L::load(lo)};
 	}
 
-	if(r != nullptr)
-		*r = z;
-	return iter;
+	static inline V             set1(double a)                      { return {L::set1(a), L::set1(0)}; }
+	static inline V             add(V a, V b)                       { return pair_add(a, b); }
+	static inline V             sub(V a, V b)                       { return pair_sub(a, b); }
+	static inline V             mul(V a, V b)                       { return pair_mul(a, b); }
+	static inline V             div(V a, V b)                       { return pair_div(a, b); }
+	static inline V             abs(V a)                            { return pair_abs(a); }
+	static inline V             twice(V a)                          { return {L::add(a.hi, a.hi), L::add(a.lo, a.lo)}; }
+	static inline V             square(V a)                         { return pair_square(a); }
+	static inline V             fmadd(V a, V b, V c)                { return pair_add(pair_mul(a, b), c); }
+	static inline V             blend(V a, V b, typename L::M mask) { return {L::blend(a.hi, b.hi, mask), L::blend(a.lo, b.lo, mask)}; }
+	static inline typename L::V lead(V a)                           { return a.hi; }
+};
+
+/* The arithmetic of a number type on the lanes of an instruction set,
+ * double-double is made of double lanes
+ */
+template <template <typename> class I, typename T>
+using Numbers = typename std::conditional<std::is_same<T, DoubleDouble>::value, Pairs<I<double>>, Plain<I<T>>>::type;
+
+/* Escaping orbits of estimating kernels go on to |z|^2 >= 2^16, where
+ * log|z| / d^n is close enough to the potential of the pixel for its
+ * distance estimate to hold. Smooth colouring gives the same values past
+ * any escape radius
+ */
+#define ESTIMATE_RADIUS 0x1p16
+
+/* dz/dc over z, the gradient of the potential of an escaped pixel up to a
+ * factor of d^n
+ */
+static inline void quotient(double dr, double di, double zr, double zi, double *w)
+{
+	double const norm = zr * zr + zi * zi;
+	w[0] = (dr * zr + di * zi) / norm;
+	w[1] = (di * zr - dr * zi) / norm;
+}
+
+/* The kernels iterate a batch of pixels in lockstep, one per lane. Lanes
+ * that escape (or converge) are masked out of the iteration count and
+ * keep their last |z|^2, lanes found to be periodic are masked out and
+ * keep their period. As every lane saves its orbit on the same
+ * iterations, the period is the same for all lanes caught at once. A batch
+ * stops once every lane has finished, its remainder is padded with its
+ * last pixel. Estimating kernels also carry dz/dc in the precision of
+ * the lanes and keep it and z on escape. Only ever called from the
+ * kernels below, which inline everything into code for their formula and
+ * instruction set
+ */
+template <typename F, typename A, bool Estimating>
+static inline long long iterate(Batch const &batch, typename A::T const *x, typename A::T const *y, int n, int *iter, double *norm, int *period, double *slope)
+{
+	typedef typename A::Lanes L;
+	typedef typename A::V     V;
+	typedef typename L::V     R;
+	typedef typename L::M     M;
+	typedef typename L::T     T;
+	typedef Plain<L>          D;
+
+	R const zero   = L::set1(0);
+	R const one    = L::set1(1);
+	R const radius = L::set1(Estimating ? ESTIMATE_RADIUS : 4);
+	R const tol    = L::set1(batch.tolerance * batch.tolerance);
+	V const sx     = A::set1(batch.seed_x);
+	V const sy     = A::set1(batch.seed_y);
+
+	long long executed = 0;
+	for(int i = 0; i < n; i += L::width)
+	{
+		T lanes[Estimating ? 7 : 3][L::width];
+		for(int k = 0; k < L::width; ++k)
+		{
+			if(!F::interior)
+				lanes[2][k] = 0;
+			else if(i + k < n)
+				lanes[2][k] = mandelbrot_interior((long double)x[i + k], (long double)y[i + k]);
+			else
+				lanes[2][k] = lanes[2][k - 1];
+		}
+
+		V zr, zi, kr, ki;
+		F::template start<A>(A::gather(x, i, n), A::gather(y, i, n), sx, sy, zr, zi, kr, ki);
+
+		V   zr2    = A::square(zr), zi2 = A::square(zi);
+		V   sr     = zr, si = zi;
+		R   found  = L::load(lanes[2]);
+		R   mag    = zero, escape = zero, count = zero;
+		R   ur     = zero, ui = zero, er = zero, ei = zero, fr = zero, fi = zero;
+		M   active = L::eq(found, zero);
+		int mark   = 0;
+
+		for(int j = 1; j <= batch.iterations && L::any(active); ++j)
+		{
+			V const pr = zr, pi = zi;
+			if constexpr(Estimating)
+				F::template derive<D>(A::lead(zr), A::lead(zi), A::lead(zr2), A::lead(zi2), ur, ui);
+			F::template step<A>(zr, zi, zr2, zi2, kr, ki);
+			zr2 = A::square(zr);
+			zi2 = A::square(zi);
+			mag = L::add(A::lead(zr2), A::lead(zi2));
+
+			count = L::blend(count, L::add(count, one), active);
+			M done;
+			if constexpr(F::converges)
+			{
+				R const dr = A::lead(A::sub(zr, pr));
+				R const di = A::lead(A::sub(zi, pi));
+				done = L::lt(L::fmadd(dr, dr, L::mul(di, di)), tol);
+			}
+			else
+			{
+				done = L::ge(mag, radius);
+			}
+			M escaped = L::both(active, done);
+			escape = L::blend(escape, mag, escaped);
+			active = L::clear(active, escaped);
+			if constexpr(Estimating)
+			{
+				er = L::blend(er, A::lead(zr), escaped);
+				ei = L::blend(ei, A::lead(zi), escaped);
+				fr = L::blend(fr, ur, escaped);
+				fi = L::blend(fi, ui, escaped);
+			}
+
+			if constexpr(!F::converges)
+			{
+				R const dr       = A::lead(A::sub(zr, sr));
+				R const di       = A::lead(A::sub(zi, si));
+				R const distance = L::fmadd(dr, dr, L::mul(di, di));
+				M const periodic = L::both(active, L::lt(distance, tol));
+				found  = L::blend(found, L::set1(j - mark), periodic);
+				active = L::clear(active, periodic);
+
+				if((j & (j - 1)) == 0)
+				{
+					sr   = zr;
+					si   = zi;
+					mark = j;
+				}
+			}
+		}
+		escape = L::blend(escape, mag, active);
+
+		L::store(lanes[0], count);
+		L::store(lanes[1], escape);
+		L::store(lanes[2], found);
+		if constexpr(Estimating)
+		{
+			L::store(lanes[3], er);
+			L::store(lanes[4], ei);
+			L::store(lanes[5], fr);
+			L::store(lanes[6], fi);
+		}
+		for(int k = 0; k < L::width && i + k < n; ++k)
+		{
+			iter[i + k]   = lanes[2][k] != 0 ? batch.iterations : (int)lanes[0][k];
+			norm[i + k]   = lanes[1][k];
+			period[i + k] = lanes[2][k];
+			executed     += (long long)lanes[0][k];
+			if constexpr(Estimating)
+				quotient(lanes[5][k], lanes[6][k], lanes[3][k], lanes[4][k], &slope[2 * (i + k)]);
+		}
+	}
+	return executed;
+}
+
+/* The same for a single lane, a pixel at a time, which keeps its counts
+ * in integers and leaves the loop as soon as the pixel is done
+ */
+template <typename F, typename A, bool Estimating>
+static inline long long iterate_scalar(Batch const &batch, typename A::T const *x, typename A::T const *y, int n, int *iter, double *norm, int *period, double *slope)
+{
+	typedef typename A::Lanes L;
+	typedef typename A::V     V;
+	typedef typename L::V     R;
+	typedef Plain<L>          D;
+
+	R const radius = Estimating ? ESTIMATE_RADIUS : 4;
+	R const tol    = batch.tolerance * batch.tolerance;
+	V const sx     = A::set1(batch.seed_x);
+	V const sy     = A::set1(batch.seed_y);
+
+	long long executed = 0;
+	for(int i = 0; i < n; ++i)
+	{
+		V zr, zi, kr, ki;
+		F::template start<A>(A::gather(x, i, n), A::gather(y, i, n), sx, sy, zr, zi, kr, ki);
+
+		V   zr2   = A::square(zr), zi2 = A::square(zi);
+		V   sr    = zr, si = zi;
+		R   mag   = 0, ur = 0, ui = 0;
+		int found = F::interior ? mandelbrot_interior((long double)x[i], (long double)y[i]) : 0;
+		int mark  = 0;
+
+		int j     = found != 0 ? batch.iterations : 0;
+		int steps = 0;
+		while(j < batch.iterations)
+		{
+			V const pr = zr, pi = zi;
+			if constexpr(Estimating)
+				F::template derive<D>(A::lead(zr), A::lead(zi), A::lead(zr2), A::lead(zi2), ur, ui);
+			F::template step<A>(zr, zi, zr2, zi2, kr, ki);
+			zr2 = A::square(zr);
+			zi2 = A::square(zi);
+			mag = A::lead(zr2) + A::lead(zi2);
+			j++;
+			steps++;
+
+			if constexpr(F::converges)
+			{
+				R const dr = A::lead(A::sub(zr, pr));
+				R const di = A::lead(A::sub(zi, pi));
+				if(dr * dr + di * di < tol)
+					break;
+			}
+			else
+			{
+				if(mag >= radius)
+					break;
+
+				R const dr = A::lead(A::sub(zr, sr));
+				R const di = A::lead(A::sub(zi, si));
+				if(dr * dr + di * di < tol)
+				{
+					found = j - mark;
+					j     = batch.iterations;
+				}
+				else if((j & (j - 1)) == 0)
+				{
+					sr   = zr;
+					si   = zi;
+					mark = j;
+				}
+			}
+		}
+
+		iter[i]   = j;
+		norm[i]   = mag;
+		period[i] = found;
+		executed += steps;
+		if constexpr(Estimating)
+			quotient(ur, ui, A::lead(zr), A::lead(zi), &slope[2 * i]);
+	}
+	return executed;
+}
+
+/* The kernels of every instruction set, as a function of the formula and
+ * number type. Formulas with a distance estimate get a second kernel
+ * that estimates
+ */
+template <typename F, typename T>
+struct Portable
+{
+	__attribute__((flatten))
+	static long long run(Batch const &batch, T const *x, T const *y, int n, int *iter, double *norm, int *period, double *slope)
+	{
+		if(F::estimates && batch.estimate)
+			return iterate_scalar<F, Numbers<Scalar, T>, F::estimates>(batch, x, y, n, iter, norm, period, slope);
+		else
+			return iterate_scalar<F, Numbers<Scalar, T>, false>(batch, x, y, n, iter, norm, period, slope);
+	}
+};
+
+#ifdef ALGORITHMS_X86
+template <typename F, typename T>
+struct Sse2Kernel
+{
+	__attribute__((flatten))
+	static long long run(Batch const &batch, T const *x, T const *y, int n, int *iter, double *norm, int *period, double *slope)
+	{
+		if(F::estimates && batch.estimate)
+			return iterate<F, Numbers<Sse2, T>, F::estimates>(batch, x, y, n, iter, norm, period, slope);
+		else
+			return iterate<F, Numbers<Sse2, T>, false>(batch, x, y, n, iter, norm, period, slope);
+	}
+};
+
+template <typename F, typename T>
+struct Avx2Kernel
+{
+	TARGET_AVX2 __attribute__((flatten))
+	static long long run(Batch const &batch, T const *x, T const *y, int n, int *iter, double *norm, int *period, double *slope)
+	{
+		if(F::estimates && batch.estimate)
+			return iterate<F, Numbers<Avx2, T>, F::estimates>(batch, x, y, n, iter, norm, period, slope);
+		else
+			return iterate<F, Numbers<Avx2, T>, false>(batch, x, y, n, iter, norm, period, slope);
+	}
+};
+
+template <typename F, typename T>
+struct Avx512Kernel
+{
+	TARGET_AVX512 __attribute__((flatten))
+	static long long run(Batch const &batch, T const *x, T const *y, int n, int *iter, double *norm, int *period, double *slope)
+	{
+		if(F::estimates && batch.estimate)
+			return iterate<F, Numbers<Avx512, T>, F::estimates>(batch, x, y, n, iter, norm, period, slope);
+		else
+			return iterate<F, Numbers<Avx512, T>, false>(batch, x, y, n, iter, norm, period, slope);
+	}
+};
+
+#pragma GCC diagnostic pop
+#endif
+
+#pragma GCC pop_options
+
+template <typename T>
+using BatchKernel = long long (*)(Batch const &, T const *, T const *, int, int *, double *, int *, double *);
+
+/* The kernels of a number type, one for every fractal
+ */
+template <typename T>
+using Kernels = std::array<BatchKernel<T>, FRACTALS>;
+
+template <template <typename, typename> class K, typename T, typename... F>
+static Kernels<T> kernels(fractal::Formulas<F...>)
+{
+	return {{K<F, T>::run...}};
+}
+
+struct Isa
+{
+	char const             *name;
+	Kernels<float>          single;
+	Kernels<double>         dual;
+	Kernels<DoubleDouble>   pairs;
+};
+
+/* Picks the widest kernels the running processor supports. Double-double
+ * needs fused multiply-add, without it its scalar kernel falls back to
+ * std::fma
+ */
+static Isa select_isa(void)
+{
+	fractal::Registry const registry;
+
+#ifdef ALGORITHMS_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx512f"))
+		return {"AVX-512", kernels<Avx512Kernel, float>(registry), kernels<Avx512Kernel, double>(registry), kernels<Avx512Kernel, DoubleDouble>(registry)};
+	if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		return {"AVX2", kernels<Avx2Kernel, float>(registry), kernels<Avx2Kernel, double>(registry), kernels<Avx2Kernel, DoubleDouble>(registry)};
+	if(__builtin_cpu_supports("sse2"))
+		return {"SSE2", kernels<Sse2Kernel, float>(registry), kernels<Sse2Kernel, double>(registry), kernels<Portable, DoubleDouble>(registry)};
+#endif
+	return {"Scalar", kernels<Portable, float>(registry), kernels<Portable, double>(registry), kernels<Portable, DoubleDouble>(registry)};
 }
 
+static Isa const isa = select_isa();
+
+/* Long double has no vector instructions and always takes the scalar
+ * kernels
+ */
+static Kernels<long double> const extended = kernels<Portable, long double>(fractal::Registry());
+
+template <typename T>
+long long fractal_batch(Batch const &batch, T const *x, T const *y, int n, int *iter, double *norm, int *period, double *slope)
+{
+	if constexpr(std::is_same<T, float>::value)
+		return isa.single[batch.fractal](batch, x, y, n, iter, norm, period, slope);
+	else if constexpr(std::is_same<T, double>::value)
+		return isa.dual[batch.fractal](batch, x, y, n, iter, norm, period, slope);
+	else if constexpr(std::is_same<T, DoubleDouble>::value)
+		return isa.pairs[batch.fractal](batch, x, y, n, iter, norm, period, slope);
+	else
+		return extended[batch.fractal](batch, x, y, n, iter, norm, period, slope);
+}
+
+template long long fractal_batch<float>(Batch const &, float const *, float const *, int, int *, double *, int *, double *);
+template long long fractal_batch<double>(Batch const &, double const *, double const *, int, int *, double *, int *, double *);
+template long long fractal_batch<long double>(Batch const &, long double const *, long double const *, int, int *, double *, int *, double *);
+template long long fractal_batch<DoubleDouble>(Batch const &, DoubleDouble const *, DoubleDouble const *, int, int *, double *, int *, double *);
+
+char const *kernel_isa(void)
+{
+	return isa.name;
+}
@@ -2,8 +2,32 @@
 #ifndef ALGORITHMS_HH
 #define ALGORITHMS_HH
 
-#include "complex.hh"
+int  mandelbrot_interior(long double, long double);
 
-int mandelbrot(long double, long double, int, ComplexLf * = nullptr);
+/* Everything a batch of pixels is iterated with
+ */
+struct Batch
+{
+	int    fractal;    /* Formula, see functions.hh */
+	int    iterations; /* Iteration limit */
+	double tolerance;  /* Distance below which orbits count as periodic */
+	double seed_x;     /* Constant of the formula (of Julia sets) */
+	double seed_y;
+	bool   estimate;   /* Track dz/dc for distance estimates, where the formula allows */
+};
+
+/* Batched kernel of a formula and number type (float, double, long
+ * double or double-double), selected at startup for the widest
+ * instruction set available. Writes the escape iteration and the final
+ * |z|^2 of every pixel of the batch, as well as the period of the cycle
+ * found for interior pixels (0 where none was found). Estimating batches
+ * escape at a far larger radius and also write dz/dc over z on escape,
+ * two numbers per pixel, to the last array. Evaluates to the iterations
+ * actually run over all pixels, which pixels caught early by the interior
+ * or cycle tests did not run to the limit
+ */
+template <typename T>
+long long   fractal_batch(Batch const &, T const *, T const *, int, int *, double *, int *, double * = nullptr);
+char const *kernel_isa(void);
 
 #endif /* ALGORITHMS_HH */
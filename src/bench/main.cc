@@ -0,0 +1,292 @@
+/* bench/main.cc */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <getopt.h>
+#include "../state.hh"
+#include "../process.hh"
+#include "../fractal.hh"
+#include "../functions.hh"
+#include "../buffer.hh"
+#include "../cache.hh"
+#include "../algorithms.hh"
+#include "../complex.hh"
+#include "../fixed.hh"
+#include "../stats.hh"
+
+#define BENCH_WIDTH  800
+#define BENCH_HEIGHT 600
+#define BENCH_RUNS   5
+#define BENCH_ORBIT  100000
+#define BENCH_PLANE  200.0L /* Scale of the plane every fractal is rendered over */
+#define BENCH_CAP    1000
+
+/* Renders a fixed set of views through the same workers and fractals as
+ * the interactive program, for every combination of thread count and
+ * iteration cap, and prints one CSV line per combination on stdout. Each
+ * combination is rendered once to warm up (which also leaves the
+ * reference orbit of deep views computed) and then timed over a number of
+ * runs, with the tile cache cleared before every run. The iterations
+ * reported are those the kernels ran, on average over the timed runs,
+ * so that pixels caught early, guessed or filled in do not count as
+ * work they did not do. A second table renders every fractal
+ * over the same plane at all threads, to hold the formulas against each
+ * other. A third compares the reference orbit arithmetic of long double
+ * with fixed point at a few depths
+ */
+
+struct Bench
+{
+	char const *name;
+	long double x;
+	long double y;
+	long double scale;
+};
+
+static Bench const views[] = {
+	{"full",      -0.75L,                   0.0L,                   256.0L},
+	{"seahorse",  -0.743643887037151L,      0.131825904205330L,     1e5L},
+	{"elephant",   0.2925L,                 0.0149L,                5e3L},
+	{"interior",  -0.2L,                    0.1L,                   1500.0L},
+	{"needle",    -1.985540371654130485L,   0.0L,                   1e16L},
+};
+
+static int const iteration_caps[] = {1000, 10000};
+
+static long double const orbit_scales[] = {1e30L, 1e100L, 1e300L};
+
+State state;
+
+/* Keeps the timed orbits from being optimized away */
+static volatile double orbit_sink;
+
+static double    render(void);
+static long long iterations(void);
+template <typename T>
+static double    orbit(T const &, T const &);
+static void      usage(char const *);
+
+int main(int argc, char **argv)
+{
+	static option const options[] = {
+		{"width",     required_argument, NULL, 'w'},
+		{"height",    required_argument, NULL, 'h'},
+		{"runs",      required_argument, NULL, 'r'},
+		{"threads",   required_argument, NULL, 't'},
+		{"strategy",  required_argument, NULL, 'm'},
+		{"estimate",  no_argument,       NULL, 'e'},
+		{"antialias", no_argument,       NULL, 'a'},
+		{"help",      no_argument,       NULL, 'H'},
+		{NULL,        0,                 NULL, 0}
+	};
+	int runs    = BENCH_RUNS;
+	int threads = std::min(std::max((int)std::thread::hardware_concurrency(), MIN_THREADS), MAX_THREADS);
+	int option;
+
+	state.width  = BENCH_WIDTH;
+	state.height = BENCH_HEIGHT;
+	while((option = getopt_long(argc, argv, "w:h:r:t:m:ea", options, NULL)) != -1)
+	{
+		switch(option)
+		{
+		case 'w':
+			state.width = std::atoi(optarg);
+			break;
+		case 'h':
+			state.height = std::atoi(optarg);
+			break;
+		case 'r':
+			runs = std::atoi(optarg);
+			break;
+		case 't':
+			threads = std::atoi(optarg);
+			break;
+		case 'm':
+			state.strategy = std::atoi(optarg);
+			break;
+		case 'e':
+			state.estimate = true;
+			break;
+		case 'a':
+			state.antialias = true;
+			break;
+		case 'H':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if(optind != argc || state.width < 1 || state.height < 1 || runs < 1
+	|| threads < MIN_THREADS || threads > MAX_THREADS || state.strategy < 0 || state.strategy >= STRATEGIES)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	/* One thread, half the threads and all of them */
+	std::vector<int> thread_counts = {1, threads / 2, threads};
+	thread_counts.erase(std::remove(thread_counts.begin(), thread_counts.end(), 0), thread_counts.end());
+	thread_counts.erase(std::unique(thread_counts.begin(), thread_counts.end()), thread_counts.end());
+
+	std::printf("# %s v%s, %s kernel\n", PROGRAM, VERSION, kernel_isa());
+	std::printf("view,width,height,strategy,precision,threads,iterations,runs,mean_s,stddev_s,min_s,mpixel_s,giter_s\n");
+	std::fflush(stdout);
+
+	buffer::resize();
+	for(Bench const &view : views)
+	{
+		for(int cap : iteration_caps)
+		{
+			for(int count : thread_counts)
+			{
+				state.x          = view.x;
+				state.y          = view.y;
+				state.scale      = view.scale;
+				state.iterations = cap;
+				state.threads    = count;
+				process::setup_threads();
+
+				render();
+
+				std::vector<double> times;
+				double              total = 0.0;
+				for(int i = 0; i < runs; ++i)
+				{
+					times.push_back(render());
+					total += (double)iterations() / runs;
+				}
+
+				double mean = 0.0, variance = 0.0;
+				for(double time : times)
+					mean += time / runs;
+				for(double time : times)
+					variance += (time - mean) * (time - mean) / runs;
+
+				double const pixels = (double)state.width * state.height;
+				std::printf
+				(
+					"%s,%d,%d,%d,%s,%d,%d,%d,%.6f,%.6f,%.6f,%.3f,%.3f\n",
+					view.name, state.width, state.height, state.strategy, process::precision_name(process::precision()), count, cap, runs,
+					mean, std::sqrt(variance), *std::min_element(times.begin(), times.end()),
+					pixels / mean * 1e-6, total / mean * 1e-9
+				);
+				std::fflush(stdout);
+			}
+		}
+	}
+
+	std::printf("fractal,precision,threads,iterations,runs,mean_s,mpixel_s,giter_s\n");
+	for(int fractal = 0; fractal < FRACTALS; ++fractal)
+	{
+		state.x          = 0;
+		state.y          = 0;
+		state.scale      = BENCH_PLANE;
+		state.iterations = BENCH_CAP;
+		state.threads    = threads;
+		state.fractal    = fractal;
+		process::setup_threads();
+
+		render();
+
+		double mean = 0.0, total = 0.0;
+		for(int i = 0; i < runs; ++i)
+		{
+			mean  += render() / runs;
+			total += (double)iterations() / runs;
+		}
+
+		std::printf
+		(
+			"%s,%s,%d,%d,%d,%.6f,%.3f,%.3f\n",
+			fractal::formula(fractal).name, process::precision_name(process::precision()), threads, BENCH_CAP, runs,
+			mean, (double)state.width * state.height / mean * 1e-6, total / mean * 1e-9
+		);
+		std::fflush(stdout);
+	}
+	state.fractal = Fractal::MANDELBROT;
+
+	long double const x = views[4].x;
+	long double const y = views[4].y;
+	std::printf("number,limbs,scale,miter_s\n");
+	std::printf("long double,0,0,%.3f\n", orbit<long double>(x, y) * 1e-6);
+	for(long double scale : orbit_scales)
+	{
+		int const limbs = Fixed::limbs(scale);
+		std::printf("fixed,%d,%.0Le,%.3f\n", limbs, scale, orbit<Fixed>(Fixed(x, limbs), Fixed(y, limbs)) * 1e-6);
+		std::fflush(stdout);
+	}
+
+	process::quit();
+	buffer::free();
+	return 0;
+}
+
+/* Renders the view from scratch and evaluates to the wall time taken
+ */
+static double render(void)
+{
+	cache::clear();
+	buffer::set_invalid();
+
+	auto const start = std::chrono::steady_clock::now();
+	process::dispatch();
+	process::await();
+	auto const end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double>(end - start).count();
+}
+
+/* Iterates the orbit of a point of the set as the reference orbit of
+ * perturbation is iterated, and evaluates to iterations per second
+ */
+template <typename T>
+static double orbit(T const &x, T const &y)
+{
+	Complex<T> const c{x, y};
+	Complex<T>       z{0, 0};
+
+	auto const start = std::chrono::steady_clock::now();
+	for(int i = 0; i < BENCH_ORBIT; ++i)
+		z = z.square() + c;
+	auto const end = std::chrono::steady_clock::now();
+
+	orbit_sink = (double)z.real();
+
+	return BENCH_ORBIT / std::chrono::duration<double>(end - start).count();
+}
+
+/* The iterations the kernels ran for the last render
+ */
+static long long iterations(void)
+{
+	stats::Frame frame;
+	stats::snapshot(&frame);
+	return frame.iterations;
+}
+
+static void usage(char const *program)
+{
+	std::fprintf
+	(
+		stderr,
+		"Usage: %s [options]\n"
+		"  -w, --width <n>     Image width (default %d)\n"
+		"  -h, --height <n>    Image height (default %d)\n"
+		"  -r, --runs <n>      Timed runs per combination (default %d)\n"
+		"  -t, --threads <n>   Most threads to run with\n"
+		"  -m, --strategy <n>  0 raster, 1 progressive, 2 subdivide\n"
+		"  -e, --estimate      Fill the exterior from distance estimates\n"
+		"  -a, --antialias     Supersample the pixels on edges\n",
+		program,
+		BENCH_WIDTH,
+		BENCH_HEIGHT,
+		BENCH_RUNS
+	);
+}
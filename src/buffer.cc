@@ -0,0 +1,573 @@
+/* buffer.cc */
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <atomic>
+#include <vector>
+#include <pthread.h>
+#include "buffer.hh"
+#include "fractal.hh"
+#include "state.hh"
+
+#define PAINT_MIN  0x4000 /* Least pixels worth a thread of their own */
+#define EDGE_SHARE 4      /* Pixels per pixel with room for supersamples */
+#define DIRTY_BAND 16     /* Rows to a bit of the dirty rows */
+
+namespace buffer
+{
+	/* Samples the workers render into and the colours painted from them.
+	 * Samples are painted while workers still write them, so each is
+	 * stored and loaded whole
+	 */
+	static std::atomic<Sample> *sbuffer = NULL;
+	static int                 *vbuffer = NULL;
+
+	static_assert(std::atomic<Sample>::is_always_lock_free, "samples must be stored without a lock");
+
+	/* Supersamples of edge pixels, SUPERSAMPLES to a slot of the pool. A
+	 * pixel without any has slot -1. Slots are taken by the workers, which
+	 * publish a slot once its supersamples are in the pool, and only given
+	 * back while none renders
+	 */
+	static std::atomic<int> *slots    = NULL;
+	static Sample           *pool     = NULL;
+	static int               capacity = 0;
+	static std::atomic<int>  used{0};
+
+	/* Rows changed since the pixels were last painted, a bit to every band
+	 * of DIRTY_BAND rows so that workers can mark them without a lock, and
+	 * rows far apart (such as a row and its mirror image) are painted
+	 * apart rather than along with every row in between
+	 */
+	static std::atomic<std::uint64_t> *dirty_bands = NULL;
+	static int                          dirty_words = 0;
+
+	/* Counts the times samples were dropped or moved to other pixels */
+	static unsigned epochs = 0;
+
+	/* A band of rows of the colouring pass, painted to rows of pitch
+	 * pixels from target, which holds row origin first
+	 */
+	struct Band
+	{
+		int  from, to;
+		int  iterations;
+		int  density;
+		int *target;
+		int  pitch;
+		int  origin;
+		void (*pass)(Band const *);
+	};
+
+	/* Threads the colouring passes are split over, started as the first
+	 * pass needs them and parked in between. The thread calling a pass
+	 * paints its first band itself, painter i paints band i
+	 */
+	struct Painter
+	{
+		pthread_t thread;
+		int       index;
+		unsigned  seen;
+	};
+
+	static Painter         painters[MAX_THREADS];
+	static Band            bands[MAX_THREADS];
+	static int             started    = 0;
+	static int             dealt      = 0;
+	static int             remaining  = 0;
+	static unsigned        sweep      = 0;
+	static bool            halting    = false;
+	static pthread_mutex_t paint_lock = PTHREAD_MUTEX_INITIALIZER;
+	static pthread_cond_t  paint_wake = PTHREAD_COND_INITIALIZER;
+	static pthread_cond_t  paint_done = PTHREAD_COND_INITIALIZER;
+
+	static void drop_supersamples(void);
+	static void compact(void);
+	static void stop_painters(void);
+
+	void resize(void)
+	{
+		if(sbuffer != NULL)
+			free();
+
+		capacity    = state.width * state.height / EDGE_SHARE + 1;
+		dirty_words = ((state.height + DIRTY_BAND - 1) / DIRTY_BAND + 63) / 64;
+		sbuffer     = new std::atomic<Sample>[state.width * state.height];
+		slots       = new std::atomic<int>[state.width * state.height];
+		pool        = new Sample[capacity * SUPERSAMPLES];
+		dirty_bands = new std::atomic<std::uint64_t>[dirty_words]();
+		assert(sbuffer != NULL && slots != NULL && pool != NULL && dirty_bands != NULL);
+		drop_supersamples();
+		epochs++;
+	}
+
+	void free(void)
+	{
+		stop_painters();
+		delete[] sbuffer;
+		delete[] vbuffer;
+		delete[] slots;
+		delete[] pool;
+		delete[] dirty_bands;
+		sbuffer     = NULL;
+		vbuffer     = NULL;
+		slots       = NULL;
+		pool        = NULL;
+		dirty_bands = NULL;
+		dirty_words = 0;
+	}
+
+	static void drop_supersamples(void)
+	{
+		for(int i = 0; i < state.width * state.height; ++i)
+			slots[i].store(-1, std::memory_order_relaxed);
+		used = 0;
+	}
+
+	void set_invalid(void)
+	{
+		for(int i = 0; i < state.width * state.height; ++i)
+			sbuffer[i].store({SAMPLE_INVALID, 0.0f}, std::memory_order_relaxed);
+		drop_supersamples();
+		touch(0, state.height);
+		epochs++;
+	}
+
+	/* Stays the same for as long as every sample stays where it is, so
+	 * that whoever found pixels final can tell they still are
+	 */
+	unsigned epoch(void)
+	{
+		return epochs;
+	}
+
+	/* The bits of the bands first up to last in word i of the bitmap
+	 */
+	static std::uint64_t band_mask(int i, int first, int last)
+	{
+		int const low  = std::max(first - i * 64, 0);
+		int const high = std::min(last - i * 64, 64);
+
+		if(low >= high)
+			return 0;
+		return (high - low == 64 ? ~0ULL : ((1ULL << (high - low)) - 1)) << low;
+	}
+
+	static bool marked(int band)
+	{
+		return (dirty_bands[band / 64].load(std::memory_order_relaxed) >> (band % 64)) & 1;
+	}
+
+	/* Marks the rows from up to to as changed
+	 */
+	void touch(int from, int to)
+	{
+		from = std::max(from, 0);
+		to   = std::min(to, state.height);
+		if(from >= to)
+			return;
+
+		int const first = from / DIRTY_BAND;
+		int const last  = (to - 1) / DIRTY_BAND + 1;
+		for(int i = first / 64; i <= (last - 1) / 64; ++i)
+			dirty_bands[i].fetch_or(band_mask(i, first, last), std::memory_order_release);
+	}
+
+	/* Whether any rows changed since they were last painted
+	 */
+	bool dirty(void)
+	{
+		for(int i = 0; i < dirty_words; ++i)
+		{
+			if(dirty_bands[i].load(std::memory_order_relaxed) != 0)
+				return true;
+		}
+		return false;
+	}
+
+	/* Takes the first run of rows changed since they were last painted at
+	 * or below the given row, if any. Taking the runs one after the other
+	 * from where the last one ended goes over the buffer once, rows marked
+	 * behind that wait for the next time
+	 */
+	bool dirty(int row, int *from, int *to)
+	{
+		int const bands = (state.height + DIRTY_BAND - 1) / DIRTY_BAND;
+		int       first = std::max(row, 0) / DIRTY_BAND;
+		int       last;
+
+		while(first < bands && !marked(first))
+			first++;
+		if(first >= bands)
+			return false;
+		for(last = first + 1; last < bands && marked(last); ++last);
+
+		// Cleared before painting, rows changed meanwhile are marked again
+		for(int i = first / 64; i <= (last - 1) / 64; ++i)
+			dirty_bands[i].fetch_and(~band_mask(i, first, last), std::memory_order_acquire);
+
+		*from = first * DIRTY_BAND;
+		*to   = std::min(last * DIRTY_BAND, state.height);
+		return true;
+	}
+
+	bool supersampled(int x, int y)
+	{
+		return slots[y * state.width + x] >= 0;
+	}
+
+	/* Keeps the supersamples of a pixel, unless the pool has run out
+	 */
+	bool supersample(int x, int y, Sample const *samples)
+	{
+		int const slot = used.fetch_add(1, std::memory_order_relaxed);
+		if(slot >= capacity)
+		{
+			used = capacity;
+			return false;
+		}
+
+		std::copy(samples, samples + SUPERSAMPLES, pool + slot * SUPERSAMPLES);
+		slots[y * state.width + x].store(slot, std::memory_order_release);
+		return true;
+	}
+
+	void set_manual(int index, Sample sample)
+	{
+		sbuffer[index].store(sample, std::memory_order_relaxed);
+	}
+
+	void set(int x, int y, Sample sample)
+	{
+		set_manual(y * state.width + x, sample);
+	}
+	
+	Sample sample(int x, int y)
+	{
+		return sbuffer[y * state.width + x].load(std::memory_order_relaxed);
+	}
+
+	/* The colours painted without a target, only allocated once asked
+	 * for as a window paints straight into its texture
+	 */
+	int *pixels(void)
+	{
+		if(vbuffer == NULL)
+			vbuffer = new int[state.width * state.height];
+		return vbuffer;
+	}
+
+	/* Paints a band a row at a time, from a copy of the samples of the
+	 * row as workers may still be writing them
+	 */
+	static void paint_band(Band const *band)
+	{
+		std::vector<Sample> row(state.width);
+
+		for(int y = band->from; y < band->to; ++y)
+		{
+			for(int x = 0; x < state.width; ++x)
+				row[x] = sbuffer[y * state.width + x].load(std::memory_order_relaxed);
+			fractal::paint(row.data(), band->target + (y - band->origin) * band->pitch, state.width, band->iterations, band->density);
+		}
+	}
+
+	/* Paints every supersampled pixel of a band over with the average of
+	 * its colour and the colours of its supersamples. The colour is
+	 * painted anew, the target may be write only
+	 */
+	static void resolve_band(Band const *band)
+	{
+		Sample samples[SUPERSAMPLES + 1];
+		int    colors[SUPERSAMPLES + 1];
+
+		for(int y = band->from; y < band->to; ++y)
+		{
+			for(int x = 0; x < state.width; ++x)
+			{
+				int const i    = y * state.width + x;
+				int const slot = slots[i].load(std::memory_order_acquire);
+				if(slot < 0)
+					continue;
+
+				samples[0] = sbuffer[i].load(std::memory_order_relaxed);
+				std::copy(pool + slot * SUPERSAMPLES, pool + (slot + 1) * SUPERSAMPLES, samples + 1);
+				fractal::paint(samples, colors, SUPERSAMPLES + 1, band->iterations, band->density);
+
+				int r = 0, g = 0, b = 0;
+				for(int k = 0; k <= SUPERSAMPLES; ++k)
+				{
+					r += (colors[k] >> 16) & 0xff;
+					g += (colors[k] >> 8)  & 0xff;
+					b += (colors[k])       & 0xff;
+				}
+				r = (r + SUPERSAMPLES / 2) / (SUPERSAMPLES + 1);
+				g = (g + SUPERSAMPLES / 2) / (SUPERSAMPLES + 1);
+				b = (b + SUPERSAMPLES / 2) / (SUPERSAMPLES + 1);
+				band->target[(y - band->origin) * band->pitch + x] = (colors[0] & 0xff000000) | (r << 16) | (g << 8) | b;
+			}
+		}
+	}
+
+	/* Painter thread, sleeps until the next pass and paints its band if
+	 * the pass has one for it
+	 */
+	static void *paint_bands(void *argp)
+	{
+		Painter *self = (Painter *)argp;
+
+		for(;;)
+		{
+			pthread_mutex_lock(&paint_lock);
+			while(self->seen == sweep && !halting)
+				pthread_cond_wait(&paint_wake, &paint_lock);
+			self->seen = sweep;
+			bool const mine = self->index < dealt;
+			pthread_mutex_unlock(&paint_lock);
+
+			if(halting)
+				break;
+			if(!mine)
+				continue;
+
+			bands[self->index].pass(&bands[self->index]);
+			pthread_mutex_lock(&paint_lock);
+			if(--remaining == 0)
+				pthread_cond_signal(&paint_done);
+			pthread_mutex_unlock(&paint_lock);
+		}
+
+		pthread_exit(NULL);
+	}
+
+	/* Stops and joins every painter
+	 */
+	static void stop_painters(void)
+	{
+		pthread_mutex_lock(&paint_lock);
+		halting = true;
+		pthread_cond_broadcast(&paint_wake);
+		pthread_mutex_unlock(&paint_lock);
+
+		for(int i = 1; i < started; ++i)
+			pthread_join(painters[i].thread, NULL);
+
+		halting = false;
+		started = 0;
+	}
+
+	/* Runs a pass over the rows from up to to, split in bands over as many
+	 * threads as render, colouring against the iteration limit the samples
+	 * were rendered with. Without a target it paints the pixels of the
+	 * buffer, otherwise the target starts at row from and the pitch is in
+	 * bytes
+	 */
+	static void banded(void (*pass)(Band const *), int iterations, int *target, int pitch, int from, int to)
+	{
+		int const   height = std::min(to, state.height) - from;
+		int const   n      = std::max(1, std::min({state.threads, height, height * state.width / PAINT_MIN}));
+		int *const  rows   = target != NULL ? target : pixels();
+
+		if(height <= 0)
+			return;
+		for(int i = 0; i < n; ++i)
+		{
+			bands[i].from       = from + (long long)height * i / n;
+			bands[i].to         = from + (long long)height * (i + 1) / n;
+			bands[i].iterations = iterations;
+			bands[i].density    = state.color;
+			bands[i].target     = rows;
+			bands[i].pitch      = target != NULL ? pitch / (int)sizeof(int) : state.width;
+			bands[i].origin     = target != NULL ? from : 0;
+			bands[i].pass       = pass;
+		}
+		if(n == 1)
+		{
+			pass(&bands[0]);
+			return;
+		}
+
+		pthread_mutex_lock(&paint_lock);
+		for(started = std::max(started, 1); started < n; ++started)
+		{
+			painters[started].index = started;
+			painters[started].seen  = sweep;
+			pthread_create(&painters[started].thread, NULL, paint_bands, &painters[started]);
+		}
+		dealt     = n;
+		remaining = n - 1;
+		sweep++;
+		pthread_cond_broadcast(&paint_wake);
+		pthread_mutex_unlock(&paint_lock);
+
+		pass(&bands[0]);
+
+		pthread_mutex_lock(&paint_lock);
+		while(remaining > 0)
+			pthread_cond_wait(&paint_done, &paint_lock);
+		pthread_mutex_unlock(&paint_lock);
+	}
+
+	/* Colours the samples of the rows from up to to into the pixels, or
+	 * straight into the rows of a target such as a locked texture. Cheap
+	 * next to rendering, so it is simply redone for every changed row
+	 */
+	void paint(int iterations, int *target, int pitch, int from, int to)
+	{
+		banded(paint_band, iterations, target, pitch, from, to);
+	}
+
+	/* Smooths the edges of the painted rows with their supersamples
+	 */
+	void resolve(int iterations, int *target, int pitch, int from, int to)
+	{
+		if(used != 0)
+			banded(resolve_band, iterations, target, pitch, from, to);
+	}
+
+	/* Coordinates of the buffer contents, as of the last shift or
+	 * reprojection
+	 */
+	static Fixed       px = 0;
+	static Fixed       py = 0;
+	static long double ps = 0;
+
+	/* Shifts the video buffer according to how the coordinates moved
+	 * since last render
+	 */
+	void shift(void)
+	{
+		const int dx = (long double)(state.x - px) * state.scale;
+		const int dy = (long double)(py - state.y) * state.scale;
+		
+		auto lambda = [=](int x, int y) -> void
+		{
+			const int rx = x + dx;
+			const int ry = y + dy;
+			if(rx < 0 || rx >= state.width || ry < 0 || ry >= state.height)
+			{
+				set(x, y, {SAMPLE_INVALID, 0.0f});
+				slots[y * state.width + x].store(-1, std::memory_order_relaxed);
+			}
+			else
+			{
+				set(x, y, sample(rx, ry));
+				slots[y * state.width + x].store(slots[ry * state.width + rx].load(std::memory_order_relaxed), std::memory_order_relaxed);
+			}
+		};
+		
+		for(int y  = (dy < 0 ? state.height-1 : 0)
+		   ;    y != (dy < 0 ? -1             : state.height)
+		   ;    y += (dy < 0 ? -1             : 1))
+		{
+			for(int x  = (dx < 0 ? state.width-1 : 0)
+			   ;    x != (dx < 0 ? -1            : state.width)
+			   ;    x += (dx < 0 ? -1            : 1))
+			{
+				lambda(x, y);
+			}
+		}
+
+		if(used > capacity / 2)
+			compact();
+
+		touch(0, state.height);
+		if(dx != 0 || dy != 0)
+			epochs++;
+		px = state.x;
+		py = state.y;
+		ps = state.scale;
+	}
+
+	/* Gives back the slots of the supersamples shifted off screen, in
+	 * place as live slots only ever move down
+	 */
+	static void compact(void)
+	{
+		std::vector<int> order;
+		int const        count = state.width * state.height;
+
+		for(int i = 0; i < count; ++i)
+		{
+			if(slots[i] >= 0)
+				order.push_back(i);
+		}
+		std::sort(order.begin(), order.end(), [](int a, int b) { return slots[a] < slots[b]; });
+
+		for(int k = 0; k < (int)order.size(); ++k)
+		{
+			int const i = order[k];
+			std::copy(pool + slots[i] * SUPERSAMPLES, pool + (slots[i] + 1) * SUPERSAMPLES, pool + k * SUPERSAMPLES);
+			slots[i] = k;
+		}
+		used = order.size();
+	}
+
+	/* Maps the video buffer onto the view after a zoom by a factor of two.
+	 * Zooming in, every other pixel of every other row is an exact sample
+	 * of the old view and the others are previewed with the old pixel they
+	 * lie in. Zooming out, the old view shrinks to the centre quarter of
+	 * the screen, where every pixel is exact. Any other change of view
+	 * invalidates the buffer
+	 */
+	void reproject(void)
+	{
+		long double const sx = (long double)(state.x - px) * ps;
+		long double const sy = (long double)(py - state.y) * ps;
+		long long   const dx = std::llround(sx);
+		long long   const dy = std::llround(sy);
+		bool        const in = state.scale == ps * 2;
+
+		if(state.scale == ps)
+		{
+			shift();
+			return;
+		}
+
+		drop_supersamples();
+		if((!in && state.scale * 2 != ps) || sx != dx || sy != dy
+		|| std::llabs(dx) > state.width || std::llabs(dy) > state.height)
+		{
+			set_invalid();
+		}
+		else
+		{
+			std::vector<Sample> old(state.width * state.height);
+			for(int i = 0; i < state.width * state.height; ++i)
+				old[i] = sbuffer[i].load(std::memory_order_relaxed);
+			int const cx = state.width  / 2;
+			int const cy = state.height / 2;
+
+			for(int y = 0; y < state.height; ++y)
+			{
+				int const ry = y - cy;
+				int const oy = cy + dy + (in ? (ry >= 0 ? ry / 2 : (ry - 1) / 2) : ry * 2);
+
+				for(int x = 0; x < state.width; ++x)
+				{
+					int const rx = x - cx;
+					int const ox = cx + dx + (in ? (rx >= 0 ? rx / 2 : (rx - 1) / 2) : rx * 2);
+					Sample    c  = {SAMPLE_INVALID, 0.0f};
+
+					if(ox >= 0 && ox < state.width && oy >= 0 && oy < state.height)
+					{
+						bool const exact = !in || (rx % 2 == 0 && ry % 2 == 0);
+						c = old[oy * state.width + ox];
+						if(!exact)
+							c = c.preview();
+					}
+					set(x, y, c);
+				}
+			}
+		}
+
+		touch(0, state.height);
+		epochs++;
+		px = state.x;
+		py = state.y;
+		ps = state.scale;
+	}
+}
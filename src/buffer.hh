@@ -0,0 +1,40 @@
+/* buffer.hh */
+#ifndef BUFFER_HH
+#define BUFFER_HH
+
+#include <cstddef>
+#include <climits>
+#include "fractal.hh"
+
+#define SUPERSAMPLES 4 /* Jittered samples of a pixel on an edge, besides its own */
+
+/* The video buffer the workers render into, one sample per pixel of the
+ * state's width and height, and the ARGB colours painted from it. Kept
+ * apart from graphics so that it can be rendered into without a window,
+ * a window has the colours of the rows that changed painted straight into
+ * its texture instead.
+ * Pixels on edges can hold SUPERSAMPLES more samples, which resolve()
+ * averages their colour over
+ */
+namespace buffer
+{
+	void     resize(void);
+	void     free(void);
+	void     set(int, int, Sample);
+	void     set_manual(int, Sample);
+	Sample   sample(int, int);
+	int     *pixels(void);
+	void     paint(int, int * = NULL, int = 0, int = 0, int = INT_MAX);
+	void     resolve(int, int * = NULL, int = 0, int = 0, int = INT_MAX);
+	void     touch(int, int);
+	bool     dirty(void);
+	bool     dirty(int, int *, int *);
+	bool     supersampled(int, int);
+	bool     supersample(int, int, Sample const *);
+	void     set_invalid(void);
+	unsigned epoch(void);
+	void     shift(void);
+	void     reproject(void);
+}
+
+#endif /* BUFFER_HH */
@@ -0,0 +1,138 @@
+/* cache.cc */
+#include <algorithm>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include <pthread.h>
+#include "cache.hh"
+
+#define ENTRY_OVERHEAD 128 /* Rough size of the list and map nodes of a tile */
+
+namespace cache
+{
+	bool Key::operator ==(Key const &key) const
+	{
+		return fractal    == key.fractal
+		    && iterations == key.iterations
+		    && variable   == key.variable
+		    && estimate   == key.estimate
+		    && strategy   == key.strategy
+		    && level      == key.level
+		    && x          == key.x
+		    && y          == key.y;
+	}
+
+	struct Hash
+	{
+		std::size_t operator ()(Key const &key) const
+		{
+			std::size_t hash = std::hash<long long>()(key.x);
+			hash = hash * 31 + std::hash<long long>()(key.y);
+			hash = hash * 31 + key.level;
+			hash = hash * 31 + key.iterations;
+			hash = hash * 31 + key.fractal;
+			hash = hash * 31 + key.variable;
+			hash = hash * 31 + key.estimate;
+			return hash * 31 + key.strategy;
+		}
+	};
+
+	struct Entry
+	{
+		Key              key;
+		std::vector<Sample> samples;
+	};
+
+	/* Most recently used tiles at the front */
+	static std::list<Entry>                                            entries;
+	static std::unordered_map<Key, std::list<Entry>::iterator, Hash>  index;
+	static std::size_t                                                 limit = 0;
+	static std::size_t                                                 used  = 0;
+	static pthread_mutex_t                                             lock  = PTHREAD_MUTEX_INITIALIZER;
+
+	static std::size_t cost(Entry const &entry)
+	{
+		return entry.samples.size() * sizeof(Sample) + ENTRY_OVERHEAD;
+	}
+
+	/* Drops least recently used tiles until the cache fits its budget
+	 */
+	static void evict(void)
+	{
+		while(used > limit && !entries.empty())
+		{
+			used -= cost(entries.back());
+			index.erase(entries.back().key);
+			entries.pop_back();
+		}
+	}
+
+	void budget(std::size_t bytes)
+	{
+		pthread_mutex_lock(&lock);
+		limit = bytes;
+		evict();
+		pthread_mutex_unlock(&lock);
+	}
+
+	/* Copies a tile of count samples out of the cache if it is there, and
+	 * marks it as most recently used
+	 */
+	bool load(Key const &key, Sample *samples, int count)
+	{
+		pthread_mutex_lock(&lock);
+		auto found = index.find(key);
+		bool hit   = found != index.end() && (int)found->second->samples.size() == count;
+		if(hit)
+		{
+			entries.splice(entries.begin(), entries, found->second);
+			std::copy(found->second->samples.begin(), found->second->samples.end(), samples);
+		}
+		pthread_mutex_unlock(&lock);
+		return hit;
+	}
+
+	void store(Key const &key, Sample const *samples, int count)
+	{
+		pthread_mutex_lock(&lock);
+		auto found = index.find(key);
+		if(found != index.end())
+		{
+			used -= cost(*found->second);
+			entries.erase(found->second);
+			index.erase(found);
+		}
+
+		entries.push_front({key, std::vector<Sample>(samples, samples + count)});
+		index[key] = entries.begin();
+		used += cost(entries.front());
+		evict();
+		pthread_mutex_unlock(&lock);
+	}
+
+	void clear(void)
+	{
+		pthread_mutex_lock(&lock);
+		entries.clear();
+		index.clear();
+		used = 0;
+		pthread_mutex_unlock(&lock);
+	}
+
+	std::size_t tiles(void)
+	{
+		pthread_mutex_lock(&lock);
+		std::size_t count = entries.size();
+		pthread_mutex_unlock(&lock);
+		return count;
+	}
+
+	std::size_t bytes(void)
+	{
+		pthread_mutex_lock(&lock);
+		std::size_t count = used;
+		pthread_mutex_unlock(&lock);
+		return count;
+	}
+}
@@ -0,0 +1,38 @@
+/* cache.hh */
+#ifndef CACHE_HH
+#define CACHE_HH
+
+#include <cstddef>
+#include "fractal.hh"
+
+/* Finished tiles of the global quadtree, kept in least recently used
+ * order under a memory budget so that views can be revisited without
+ * rendering them again. A tile is identified by the zoom level (the scale
+ * is 2^level pixels per unit), its position on that level in tiles, and
+ * everything else its colours depend on. That includes the strategy, as
+ * the progressive and subdividing ones keep the samples they guessed
+ */
+namespace cache
+{
+	struct Key
+	{
+		int       fractal;
+		int       iterations;
+		int       variable;
+		bool      estimate;
+		int       strategy;
+		int       level;
+		long long x, y;
+
+		bool operator ==(Key const &) const;
+	};
+
+	void        budget(std::size_t);
+	bool        load(Key const &, Sample *, int);
+	void        store(Key const &, Sample const *, int);
+	void        clear(void);
+	std::size_t tiles(void);
+	std::size_t bytes(void);
+}
+
+#endif /* CACHE_HH */
@@ -3,6 +3,8 @@
 #define COMPLEX_HH
 
 #include <cmath>
+#include "doubledouble.hh"
+#include "fixed.hh"
 
 template <typename T>
 class Complex
@@ -207,8 +209,19 @@ private:
 	T _imag;
 };
 
-typedef Complex<float>       Complexf;
-typedef Complex<double>      Complexlf;
-typedef Complex<long double> ComplexLf;
+/* Fixed-point squares take half the limb products of a multiplication,
+ * and doubling is an addition
+ */
+template <>
+inline Complex<Fixed> Complex<Fixed>::square(void) const
+{
+	return {this->real().square() - this->imag().square(), (this->real() + this->real()) * this->imag()};
+}
+
+typedef Complex<float>        Complexf;
+typedef Complex<double>       Complexlf;
+typedef Complex<long double>  ComplexLf;
+typedef Complex<DoubleDouble> Complexdd;
+typedef Complex<Fixed>        Complexfx;
 
 #endif /* COMPLEX_HH */
@@ -1,18 +1,18 @@
-/* const.h */
-#ifndef CONST_H
-#define CONST_H
-
-#define E      2.718281828459045235L
-#define PI     3.141592653589793238L
-#define PI_2   1.570796326794896619L
-#define TAU    6.283185307179586477L
-#define TAU_4  PI_2
-#define PHI    1.618033988749894848L
-#define PSI    0.618033988749894848L
-#define SQRT_2 1.414213562373095049L
-#define SQRT_3 1.732050807568877294L
-#define SQRT_5 2.236067977499789696L   
-#define SQRT_7 2.645751311064590591L
-#define LN_2   0.693147180559945309L
-
-#endif /* CONST_H */
+/* const.h */
+#ifndef CONST_H
+#define CONST_H
+
+#define E      2.718281828459045235L
+#define PI     3.141592653589793238L
+#define PI_2   1.570796326794896619L
+#define TAU    6.283185307179586477L
+#define TAU_4  PI_2
+#define PHI    1.618033988749894848L
+#define PSI    0.618033988749894848L
+#define SQRT_2 1.414213562373095049L
+#define SQRT_3 1.732050807568877294L
+#define SQRT_5 2.236067977499789696L   
+#define SQRT_7 2.645751311064590591L
+#define LN_2   0.693147180559945309L
+
+#endif /* CONST_H */
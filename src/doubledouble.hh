@@ -0,0 +1,247 @@
+/* doubledouble.hh */
+#ifndef DOUBLEDOUBLE_HH
+#define DOUBLEDOUBLE_HH
+
+#include <cmath>
+#include <limits>
+
+/* The error-free transforms below only hold in strict IEEE arithmetic,
+ * reassociating them (as -ffast-math allows) optimizes the error terms
+ * away. Callers built with fast math do not inline these functions, code
+ * that should inline them has to be built with the same options
+ */
+#pragma GCC push_options
+#pragma GCC optimize("no-fast-math")
+
+/* Unevaluated sum of two doubles with |lo| <= ulp(hi) / 2, about 106 bits
+ * of mantissa at the exponent range of a double. Addition is the cheap
+ * (sloppy) variant, which loses relative accuracy only on cancellation of
+ * nearly equal numbers
+ */
+class DoubleDouble
+{
+public:
+	DoubleDouble(int a = 0)
+	{
+		this->set(a, 0.0);
+	}
+
+	DoubleDouble(double a)
+	{
+		this->set(a, 0.0);
+	}
+
+	DoubleDouble(double hi, double lo)
+	{
+		this->set(hi, lo);
+	}
+
+	DoubleDouble(long double a)
+	{
+		double const hi = (double)a;
+		this->set(hi, (double)(a - hi));
+	}
+
+	/* a + b exactly as s + e
+	 */
+	static inline DoubleDouble two_sum(double a, double b)
+	{
+		double const s = a + b;
+		double const v = s - a;
+		return {s, (a - (s - v)) + (b - v)};
+	}
+
+	/* a + b exactly as s + e, given |a| >= |b|
+	 */
+	static inline DoubleDouble quick_two_sum(double a, double b)
+	{
+		double const s = a + b;
+		return {s, b - (s - a)};
+	}
+
+	/* a * b exactly as p + e
+	 */
+	static inline DoubleDouble two_prod(double a, double b)
+	{
+		double const p = a * b;
+		return {p, std::fma(a, b, -p)};
+	}
+
+	DoubleDouble add(const DoubleDouble &a) const
+	{
+		DoubleDouble s = two_sum(this->hi(), a.hi());
+		return quick_two_sum(s.hi(), s.lo() + this->lo() + a.lo());
+	}
+
+	DoubleDouble subtract(const DoubleDouble &a) const
+	{
+		return this->add(-a);
+	}
+
+	DoubleDouble multiply(const DoubleDouble &a) const
+	{
+		DoubleDouble p = two_prod(this->hi(), a.hi());
+		double e = std::fma(this->hi(), a.lo(), p.lo());
+		e = std::fma(this->lo(), a.hi(), e);
+		return quick_two_sum(p.hi(), e);
+	}
+
+	/* One Newton step from the double quotient
+	 */
+	DoubleDouble divide(const DoubleDouble &a) const
+	{
+		double const q = this->hi() / a.hi();
+		DoubleDouble r = this->subtract(a.multiply(q));
+		return quick_two_sum(q, r.hi() / a.hi());
+	}
+
+	DoubleDouble square(void) const
+	{
+		DoubleDouble p = two_prod(this->hi(), this->hi());
+		return quick_two_sum(p.hi(), std::fma(this->hi() + this->hi(), this->lo(), p.lo()));
+	}
+
+	int compare(const DoubleDouble &a) const
+	{
+		if(this->hi() != a.hi())
+			return this->hi() < a.hi() ? -1 : 1;
+		if(this->lo() != a.lo())
+			return this->lo() < a.lo() ? -1 : 1;
+		return 0;
+	}
+
+	void set(double hi, double lo)
+	{
+		this->_hi = hi;
+		this->_lo = lo;
+	}
+
+	explicit operator float(void) const
+	{
+		return (float)this->hi();
+	}
+
+	explicit operator double(void) const
+	{
+		return this->hi();
+	}
+
+	explicit operator long double(void) const
+	{
+		return (long double)this->hi() + this->lo();
+	}
+
+	inline double hi(void) const
+	{
+		return this->_hi;
+	}
+
+	inline double lo(void) const
+	{
+		return this->_lo;
+	}
+
+	inline DoubleDouble operator +(void) const
+	{
+		return *this;
+	}
+
+	inline DoubleDouble operator -(void) const
+	{
+		return {-this->hi(), -this->lo()};
+	}
+
+	inline DoubleDouble operator +(const DoubleDouble &a) const
+	{
+		return this->add(a);
+	}
+
+	inline DoubleDouble operator -(const DoubleDouble &a) const
+	{
+		return this->subtract(a);
+	}
+
+	inline DoubleDouble operator *(const DoubleDouble &a) const
+	{
+		return this->multiply(a);
+	}
+
+	inline DoubleDouble operator /(const DoubleDouble &a) const
+	{
+		return this->divide(a);
+	}
+
+	inline DoubleDouble operator +=(const DoubleDouble &a)
+	{
+		return *this = this->add(a);
+	}
+
+	inline DoubleDouble operator -=(const DoubleDouble &a)
+	{
+		return *this = this->subtract(a);
+	}
+
+	inline DoubleDouble operator *=(const DoubleDouble &a)
+	{
+		return *this = this->multiply(a);
+	}
+
+	inline DoubleDouble operator /=(const DoubleDouble &a)
+	{
+		return *this = this->divide(a);
+	}
+
+	inline bool operator ==(const DoubleDouble &a) const
+	{
+		return this->compare(a) == 0;
+	}
+
+	inline bool operator !=(const DoubleDouble &a) const
+	{
+		return this->compare(a) != 0;
+	}
+
+	inline bool operator <(const DoubleDouble &a) const
+	{
+		return this->compare(a) < 0;
+	}
+
+	inline bool operator >(const DoubleDouble &a) const
+	{
+		return this->compare(a) > 0;
+	}
+
+	inline bool operator <=(const DoubleDouble &a) const
+	{
+		return this->compare(a) <= 0;
+	}
+
+	inline bool operator >=(const DoubleDouble &a) const
+	{
+		return this->compare(a) >= 0;
+	}
+private:
+	double _hi;
+	double _lo;
+};
+
+#pragma GCC pop_options
+
+/* Only the precision is of any use to the renderer, the rest is that of
+ * a double
+ */
+namespace std
+{
+	template <>
+	struct numeric_limits<DoubleDouble> : public numeric_limits<double>
+	{
+		static constexpr int digits = 2 * numeric_limits<double>::digits;
+
+		static DoubleDouble epsilon(void)
+		{
+			return 0x1p-104;
+		}
+	};
+}
+
+#endif /* DOUBLEDOUBLE_HH */
@@ -0,0 +1,271 @@
+/* fixed.cc */
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include "fixed.hh"
+
+__extension__ typedef unsigned __int128 Wide;
+
+Fixed::Fixed(int a)
+{
+	this->_limb[0] = (std::uint64_t)(std::int64_t)a;
+	this->_count   = 1;
+}
+
+Fixed::Fixed(double a, int limbs) : Fixed((long double)a, limbs)
+{
+}
+
+/* Exact for every long double the limbs reach down to whose integer part
+ * fits in 63 bits, larger magnitudes saturate there
+ */
+Fixed::Fixed(long double a, int limbs)
+{
+	long double magnitude = std::fmin(std::fabs(a), 0x1p63L - 1.0L);
+	long double whole     = std::floor(magnitude);
+
+	this->_count   = std::max(1, std::min(limbs, FIXED_LIMBS));
+	this->_limb[0] = (std::uint64_t)whole;
+	magnitude     -= whole;
+	for(int i = 1; i < this->_count; ++i)
+	{
+		magnitude      = std::ldexp(magnitude, 64);
+		whole          = std::floor(magnitude);
+		this->_limb[i] = (std::uint64_t)whole;
+		magnitude     -= whole;
+	}
+
+	if(a < 0)
+		*this = this->negate();
+}
+
+int Fixed::limbs(long double scale)
+{
+	int const bits = std::max(std::ilogb(scale) + 1, 0) + FIXED_GUARD;
+	return std::min(1 + (bits + 63) / 64, FIXED_LIMBS);
+}
+
+bool Fixed::parse(char const *text, Fixed *value)
+{
+	char const   *point  = text + (*text == '-' || *text == '+');
+	char const   *end;
+	std::uint64_t whole  = 0;
+	int           digits = 0;
+
+	for(; std::isdigit((unsigned char)*point) && digits < 18; ++point, ++digits)
+		whole = whole * 10 + (*point - '0');
+	end = point;
+	if(*end == '.')
+	{
+		for(end++; std::isdigit((unsigned char)*end); ++end)
+			digits++;
+	}
+
+	if(*end != '\0' || (*point != '.' && *point != '\0') || digits == 0)
+	{
+		char *rest;
+		long double const parsed = std::strtold(text, &rest);
+		if(rest == text || *rest != '\0' || !(std::fabs(parsed) < 0x1p62L))
+			return false;
+		*value = Fixed(parsed);
+		return true;
+	}
+
+	// The fraction is built from its last digit up, as (f + d) / 10
+	Fixed fraction(0.0L);
+	for(char const *digit = end - 1; digit > point; --digit)
+	{
+		Wide rest = 0;
+		fraction._limb[0] = *digit - '0';
+		for(int i = 0; i < FIXED_LIMBS; ++i)
+		{
+			Wide const current = (rest << 64) | fraction._limb[i];
+			fraction._limb[i]  = (std::uint64_t)(current / 10);
+			rest               = current % 10;
+		}
+	}
+	fraction._limb[0] = whole;
+
+	*value = *text == '-' ? fraction.negate() : fraction;
+	return true;
+}
+
+Fixed Fixed::add(const Fixed &a) const
+{
+	Fixed sum;
+	Wide  carry = 0;
+
+	sum._count = std::max(this->_count, a._count);
+	for(int i = sum._count - 1; i >= 0; --i)
+	{
+		Wide const total = carry
+			+ (i < this->_count ? this->_limb[i] : 0)
+			+ (i < a._count     ? a._limb[i]     : 0);
+		sum._limb[i] = (std::uint64_t)total;
+		carry        = total >> 64;
+	}
+	return sum;
+}
+
+Fixed Fixed::subtract(const Fixed &a) const
+{
+	return this->add(a.negate());
+}
+
+Fixed Fixed::negate(void) const
+{
+	Fixed negated;
+	Wide  carry = 1;
+
+	negated._count = this->_count;
+	for(int i = this->_count - 1; i >= 0; --i)
+	{
+		Wide const total  = carry + (std::uint64_t)~this->_limb[i];
+		negated._limb[i] = (std::uint64_t)total;
+		carry            = total >> 64;
+	}
+	return negated;
+}
+
+/* The absolute value, widened or truncated to the given limbs
+ */
+Fixed Fixed::magnitude(int limbs) const
+{
+	Fixed absolute = this->negative() ? this->negate() : *this;
+	return absolute.truncate(limbs);
+}
+
+/* Schoolbook product of the magnitudes, one column of limbs at a time
+ * from the least significant. Columns below the last limb are dropped,
+ * but for the one right below it, which only carries into it. Squaring
+ * takes every product of two different limbs once and doubles it
+ */
+Fixed Fixed::product(const Fixed &a, bool squaring) const
+{
+	int const   n = std::max(this->_count, a._count);
+	Fixed const x = this->magnitude(this->_count);
+	Fixed const y = squaring ? x : a.magnitude(a._count);
+	Fixed       result;
+	Wide        carry = 0;
+
+	result._count = n;
+	for(int k = n; k >= 0; --k)
+	{
+		Wide      low  = carry;
+		Wide      high = 0;
+		int const from = std::max(0, k - y._count + 1);
+		int const to   = std::min(k, x._count - 1);
+
+		if(squaring)
+		{
+			for(int i = from; i < k - i && i <= to; ++i)
+			{
+				Wide const p = (Wide)x._limb[i] * x._limb[k - i];
+				low  += (Wide)(std::uint64_t)p << 1;
+				high += (p >> 64) << 1;
+			}
+			if(k % 2 == 0 && k / 2 >= from && k / 2 <= to)
+			{
+				Wide const p = (Wide)x._limb[k / 2] * x._limb[k / 2];
+				low  += (std::uint64_t)p;
+				high += p >> 64;
+			}
+		}
+		else
+		{
+			for(int i = from; i <= to; ++i)
+			{
+				Wide const p = (Wide)x._limb[i] * y._limb[k - i];
+				low  += (std::uint64_t)p;
+				high += p >> 64;
+			}
+		}
+
+		if(k < n)
+			result._limb[k] = (std::uint64_t)low;
+		carry = (low >> 64) + high;
+	}
+
+	bool const negative = !squaring && this->negative() != a.negative();
+	return negative ? result.negate() : result;
+}
+
+Fixed Fixed::multiply(const Fixed &a) const
+{
+	return this->product(a, false);
+}
+
+Fixed Fixed::square(void) const
+{
+	return this->product(*this, true);
+}
+
+/* this + a * b
+ */
+Fixed Fixed::multiply_add(const Fixed &a, const Fixed &b) const
+{
+	return this->add(a.product(b, false));
+}
+
+Fixed Fixed::truncate(int limbs) const
+{
+	Fixed truncated = *this;
+	for(int i = truncated._count; i < limbs && i < FIXED_LIMBS; ++i)
+		truncated._limb[i] = 0;
+	truncated._count = std::max(1, std::min(limbs, FIXED_LIMBS));
+	return truncated;
+}
+
+/* Limbs one of the numbers lacks count as zero
+ */
+int Fixed::compare(const Fixed &a) const
+{
+	if(this->_limb[0] != a._limb[0])
+		return (std::int64_t)this->_limb[0] < (std::int64_t)a._limb[0] ? -1 : 1;
+
+	for(int i = 1; i < std::max(this->_count, a._count); ++i)
+	{
+		std::uint64_t const p = i < this->_count ? this->_limb[i] : 0;
+		std::uint64_t const q = i < a._count     ? a._limb[i]     : 0;
+		if(p != q)
+			return p < q ? -1 : 1;
+	}
+	return 0;
+}
+
+bool Fixed::integral(void) const
+{
+	for(int i = 1; i < this->_count; ++i)
+	{
+		if(this->_limb[i] != 0)
+			return false;
+	}
+	return true;
+}
+
+Fixed::operator double(void) const
+{
+	return (double)(long double)*this;
+}
+
+Fixed::operator DoubleDouble(void) const
+{
+	double const hi = (double)*this;
+	return {hi, (double)this->subtract(Fixed(hi))};
+}
+
+Fixed::operator long double(void) const
+{
+	Fixed const absolute = this->magnitude(this->_count);
+	long double value    = 0.0L;
+	int         first    = 0;
+
+	// Two limbs after the first nonzero one are all a long double holds
+	while(first < absolute._count - 1 && absolute._limb[first] == 0)
+		first++;
+	for(int i = std::min(first + 2, absolute._count - 1); i >= first; --i)
+		value = value * 0x1p-64L + absolute._limb[i];
+	value = std::ldexp(value, -64 * first);
+	return this->negative() ? -value : value;
+}
@@ -0,0 +1,136 @@
+/* fixed.hh */
+#ifndef FIXED_HH
+#define FIXED_HH
+
+#include <cstdint>
+#include "doubledouble.hh"
+
+#define FIXED_LIMBS 18 /* Most limbs, a 64 bit integer part and 1088 fractional bits */
+#define FIXED_GUARD 64 /* Bits kept below the pixel spacing */
+
+/* Arbitrary precision fixed-point number in two's complement, as limbs
+ * of 64 bits from the most significant: limb 0 is the (signed) integer
+ * part, every further limb holds the next 64 bits of the fraction. Each
+ * number carries as many limbs as it was given, arithmetic keeps the
+ * larger count of its operands and truncates what falls below it.
+ * Products are only valid while they fit the integer limb, which is far
+ * more than any escape radius needs
+ */
+class Fixed
+{
+public:
+	Fixed(int = 0);
+	Fixed(double, int = FIXED_LIMBS);
+	Fixed(long double, int = FIXED_LIMBS);
+
+	/* Limbs needed to resolve pixels at the given scale
+	 */
+	static int limbs(long double);
+
+	/* Parses a decimal number to the most limbs, falls back to strtold()
+	 * for anything else it accepts
+	 */
+	static bool parse(char const *, Fixed *);
+
+	Fixed add(const Fixed &) const;
+	Fixed subtract(const Fixed &) const;
+	Fixed multiply(const Fixed &) const;
+	Fixed multiply_add(const Fixed &, const Fixed &) const;
+	Fixed square(void) const;
+	Fixed negate(void) const;
+	Fixed truncate(int) const;
+	int   compare(const Fixed &) const;
+	bool  integral(void) const;
+
+	explicit operator double(void) const;
+	explicit operator DoubleDouble(void) const;
+	explicit operator long double(void) const;
+
+	inline int count(void) const
+	{
+		return this->_count;
+	}
+
+	inline bool negative(void) const
+	{
+		return (std::int64_t)this->_limb[0] < 0;
+	}
+
+	inline Fixed operator +(void) const
+	{
+		return *this;
+	}
+
+	inline Fixed operator -(void) const
+	{
+		return this->negate();
+	}
+
+	inline Fixed operator +(const Fixed &a) const
+	{
+		return this->add(a);
+	}
+
+	inline Fixed operator -(const Fixed &a) const
+	{
+		return this->subtract(a);
+	}
+
+	inline Fixed operator *(const Fixed &a) const
+	{
+		return this->multiply(a);
+	}
+
+	inline Fixed operator +=(const Fixed &a)
+	{
+		return *this = this->add(a);
+	}
+
+	inline Fixed operator -=(const Fixed &a)
+	{
+		return *this = this->subtract(a);
+	}
+
+	inline Fixed operator *=(const Fixed &a)
+	{
+		return *this = this->multiply(a);
+	}
+
+	inline bool operator ==(const Fixed &a) const
+	{
+		return this->compare(a) == 0;
+	}
+
+	inline bool operator !=(const Fixed &a) const
+	{
+		return this->compare(a) != 0;
+	}
+
+	inline bool operator <(const Fixed &a) const
+	{
+		return this->compare(a) < 0;
+	}
+
+	inline bool operator >(const Fixed &a) const
+	{
+		return this->compare(a) > 0;
+	}
+
+	inline bool operator <=(const Fixed &a) const
+	{
+		return this->compare(a) <= 0;
+	}
+
+	inline bool operator >=(const Fixed &a) const
+	{
+		return this->compare(a) >= 0;
+	}
+private:
+	Fixed magnitude(int) const;
+	Fixed product(const Fixed &, bool) const;
+
+	std::uint64_t _limb[FIXED_LIMBS];
+	int           _count;
+};
+
+#endif /* FIXED_HH */
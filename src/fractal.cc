@@ -1,75 +1,271 @@
-/* fractal.cc */
-#include <cstddef>
-#include <ctime>
-#include <cstdlib>
-#include <cmath>
-#include "fractal.hh"
-#include "algorithms.hh"
-#include "state.hh"
-#include "const.h"
-#include "complex.hh"
-
-#define SET_COLOR (0x7f0000) 
-
-namespace fractal 
-{
-	static int color_fractionalize(int color, float fraction)
-	{
-		int const r = ((color >> 16) & 0xff) * fraction;
-		int const g = ((color >> 8)  & 0xff) * fraction;
-		int const b = ((color)       & 0xff) * fraction;
-
-		return (r << 16) | (g << 8) | (b);
-
-	}
-
-	static int hexcolor(int index)
-	{
-		const int color[] = {
-			0x00007f,
-			0x00003f,
-			0x00007f,
-			0x0000ff,
-			0x7f3f3f,
-			0xff7f00,
-			0xffff00,
-			0x1fff00,
-			0x00ff00,
-			0xff0000,
-			0xffffff,
-			0x000000
-		};
-
-		return color[index % 12];
-	}
-
-	static int gradient(float fraction)
-	{
-		float indexfraction = fraction * (12 - 1);
-		int   iindex = (int)indexfraction % 12;
-		float findex = indexfraction - iindex;
-		
-		int colorlow  = color_fractionalize(hexcolor(iindex), 1.0f - findex);
-		int colorhigh = color_fractionalize(hexcolor(iindex + 1), findex);
-
-		return colorlow + colorhigh;
-		
-
-	}
-	
-	int render(long double x, long double y)
-	{
-		ComplexLf z;
-		int iter;
-		int iterations = state.iterations;
-		
-		std::srand(std::time(NULL));
-		iter = mandelbrot(x, y, iterations, &z);
-		
-		double color = iter + 1 - std::log(std::log(z.modulus())) / LN_2;
-		float fraction = color / iterations;
-		int   rcol  = gradient(fraction);
-
-		return iter >= iterations ? SET_COLOR : rcol;
-	}
-}
+/* fractal.cc */
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include "fractal.hh"
+#include "algorithms.hh"
+#include "functions.hh"
+#include "perturbation.hh"
+#include "state.hh"
+#include "const.h"
+#include "complex.hh"
+
+#define SET_COLOR (0x7f0000) 
+
+#define PALETTE_COLORS 12
+#define PALETTE_STEPS  256 /* Gradient entries between two palette colors */
+#define PALETTE_SIZE   (PALETTE_COLORS * PALETTE_STEPS)
+#define PERIOD_SHADES  256 /* Periods shaded apart, longer ones share a shade */
+#define PAINT_BLOCK    256
+#define AA_CONTRAST    PALETTE_STEPS /* Gradient entries apart that make an edge */
+
+/* Orbits returning to within this fraction of a pixel of an earlier point
+ * are taken to be periodic
+ */
+#define PERIOD_TOLERANCE 0x1p-10
+
+namespace fractal 
+{
+	static int color_fractionalize(int color, float fraction)
+	{
+		int const r = ((color >> 16) & 0xff) * fraction;
+		int const g = ((color >> 8)  & 0xff) * fraction;
+		int const b = ((color)       & 0xff) * fraction;
+
+		return (r << 16) | (g << 8) | (b);
+
+	}
+
+	static int hexcolor(int index)
+	{
+		const int color[] = {
+			0x00007f,
+			0x00003f,
+			0x00007f,
+			0x0000ff,
+			0x7f3f3f,
+			0xff7f00,
+			0xffff00,
+			0x1fff00,
+			0x00ff00,
+			0xff0000,
+			0xffffff,
+			0x000000
+		};
+
+		return color[index % PALETTE_COLORS];
+	}
+
+	/* The palette gradient baked into PALETTE_STEPS entries per palette
+	 * color, together with the shades of the set by period
+	 */
+	struct Palette
+	{
+		int gradient[PALETTE_SIZE];
+		int interior[PERIOD_SHADES];
+
+		Palette(void)
+		{
+			for(int i = 0; i < PALETTE_SIZE; ++i)
+			{
+				int const   index    = i / PALETTE_STEPS;
+				float const fraction = (float)(i % PALETTE_STEPS) / PALETTE_STEPS;
+
+				this->gradient[i] = color_fractionalize(hexcolor(index), 1.0f - fraction)
+				                  + color_fractionalize(hexcolor(index + 1), fraction);
+			}
+
+			this->interior[0] = SET_COLOR;
+			for(int period = 1; period < PERIOD_SHADES; ++period)
+				this->interior[period] = color_fractionalize(SET_COLOR, 0.5f + 0.5f / period);
+		}
+	};
+
+	static Palette const palette;
+
+	/* Smooth escape time coloring of n samples, the palette repeats
+	 * 2^density times over the iteration range. Interior points are shaded
+	 * darker the longer the period of their cycle, where one was found.
+	 * Previews are coloured like the sample they were taken from. Written
+	 * without branches over blocks of pixels so that it vectorizes, only
+	 * the palette lookups are scalar
+	 */
+	void paint(Sample const *samples, int *colors, int n, int iterations, int density)
+	{
+		float const scale = (float)(PALETTE_COLORS - 1) * PALETTE_STEPS * (1 << density) / iterations;
+		float const wrap  = PALETTE_SIZE;
+
+		for(int from = 0; from < n; from += PAINT_BLOCK)
+		{
+			int const count = std::min(PAINT_BLOCK, n - from);
+			int       index[PAINT_BLOCK];
+			int       shade[PAINT_BLOCK];
+
+			for(int i = 0; i < count; ++i)
+			{
+				int const   iter   = samples[from + i].iter;
+				float const value  = samples[from + i].value;
+				int const   raw    = iter < 0 ? ~iter : iter;
+				float       offset = ((float)raw + value) * scale;
+
+				offset  -= std::floor(offset * (1.0f / wrap)) * wrap;
+				index[i] = std::min((int)offset, PALETTE_SIZE - 1);
+				shade[i] = raw >= iterations ? std::min((int)value, PERIOD_SHADES - 1) : -1;
+				shade[i] = iter == SAMPLE_INVALID ? -2 : shade[i];
+			}
+
+			for(int i = 0; i < count; ++i)
+			{
+				int const color = shade[i] >= 0 ? palette.interior[shade[i]] : palette.gradient[index[i]];
+				colors[from + i] = shade[i] == -2 ? 0 : color;
+			}
+		}
+	}
+
+	/* The least difference of smooth iteration counts outside the set
+	 * that is painted AA_CONTRAST gradient entries apart, enough to show
+	 * an edge
+	 */
+	float contrast(int iterations, int density)
+	{
+		return AA_CONTRAST * iterations / ((float)(PALETTE_COLORS - 1) * PALETTE_STEPS * (1 << density));
+	}
+
+	/* log2 of a positive number from its exponent and the atanh series of
+	 * its mantissa, accurate to about 1e-8 for a fraction of the cost of
+	 * std::log
+	 */
+	static inline double fast_log2(double x)
+	{
+		std::uint64_t bits;
+		std::memcpy(&bits, &x, sizeof(bits));
+
+		int exponent = (int)((bits >> 52) & 0x7ff) - 1023;
+		bits = (bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL;
+
+		double mantissa;
+		std::memcpy(&mantissa, &bits, sizeof(mantissa));
+		if(mantissa > (double)SQRT_2)
+		{
+			mantissa *= 0.5;
+			exponent++;
+		}
+
+		double const s  = (mantissa - 1.0) / (mantissa + 1.0);
+		double const s2 = s * s;
+		return exponent + (double)(2 / LN_2) * s * (1.0 + s2 * (1.0 / 3 + s2 * (1.0 / 5 + s2 * (1.0 / 7))));
+	}
+
+	/* Packs an iteration count and the final |z|^2 (or the period found
+	 * inside the set) into a sample. Escaping orbits are coloured smoothly
+	 * by how far past the escape radius they got, which depends on the
+	 * degree of the formula
+	 */
+	static Sample sample(int iter, double norm, int iterations, int period, double smoothing)
+	{
+		if(iter >= iterations)
+			return {iterations, (float)period};
+		if(smoothing == 0.0)
+			return {iter, 0.0f};
+		return {iter, (float)(1 - smoothing * fast_log2(fast_log2(norm) * (double)(LN_2 / 2)))};
+	}
+
+	/* 1 / log2 of the degree of a fractal, 0 if its orbits are not
+	 * coloured smoothly
+	 */
+	static double smoothing(View const &view)
+	{
+		int const degree = formula(view.fractal).degree;
+		return degree > 1 ? 1.0 / std::log2(degree) : 0.0;
+	}
+
+	static double tolerance(View const &view)
+	{
+		return PERIOD_TOLERANCE / view.scale;
+	}
+
+	/* The exterior disk of an escaped pixel, given dz/dc over z. With the
+	 * potential G = log|z| / d^n, the Koebe quarter theorem keeps the set
+	 * at least sinh(G) / (2 e^G |grad G|) away, which is log|z| / 2|dz/dc/z|
+	 * for small G
+	 */
+	static Estimate estimate(View const &view, int iter, double norm, double const *slope, double smooth)
+	{
+		double const log_z    = 0.5 * std::log(norm);
+		double const gradient = std::hypot(slope[0], slope[1]);
+		double const shrink   = 2.0 * log_z * std::pow((double)formula(view.fractal).degree, -iter);
+		double const factor   = shrink > 0.0 ? -std::expm1(-shrink) / shrink : 1.0;
+		double const radius   = log_z / (2.0 * gradient) * factor * (double)view.scale;
+		double const per      = 1.0 / (log_z * (double)view.scale);
+
+		if(!(radius >= 1.0 && radius < INT_MAX))
+			return {0.0f, 0.0f, 0.0f, 0.0f};
+		return {(float)radius, (float)(slope[0] * per), (float)(slope[1] * per), (float)(smooth / LN_2)};
+	}
+
+	/* Renders a batch of pixels given by their coordinates, in the number
+	 * type the coordinates are given in. Given room for them, views that
+	 * estimate distances also leave the exterior disks of the pixels.
+	 * Evaluates to the iterations run
+	 */
+	template <typename T>
+	long long render_points(View const &view, T const *x, T const *y, int n, Sample *samples, Estimate *estimates)
+	{
+		std::vector<int>    iter(n);
+		std::vector<double> norm(n);
+		std::vector<int>    period(n);
+		std::vector<double> slope;
+		double const        smooth = smoothing(view);
+		Batch               batch;
+
+		batch.fractal    = view.fractal;
+		batch.iterations = view.iterations;
+		batch.tolerance  = tolerance(view);
+		batch.estimate   = view.estimate && estimates != nullptr && fractal::estimates(Registry(), view.fractal);
+		seed(view.fractal, view.variable, &batch.seed_x, &batch.seed_y);
+		if(batch.estimate)
+			slope.resize(2 * n);
+		long long const executed = fractal_batch<T>(batch, x, y, n, iter.data(), norm.data(), period.data(), slope.data());
+
+		for(int i = 0; i < n; ++i)
+		{
+			samples[i] = sample(iter[i], norm[i], view.iterations, period[i], smooth);
+		}
+		for(int i = 0; i < n && estimates != nullptr; ++i)
+		{
+			estimates[i] = batch.estimate && iter[i] < view.iterations ? estimate(view, iter[i], norm[i], &slope[2 * i], smooth) : Estimate{0.0f, 0.0f, 0.0f, 0.0f};
+		}
+		return executed;
+	}
+
+	template long long render_points<float>(View const &, float const *, float const *, int, Sample *, Estimate *);
+	template long long render_points<double>(View const &, double const *, double const *, int, Sample *, Estimate *);
+	template long long render_points<long double>(View const &, long double const *, long double const *, int, Sample *, Estimate *);
+	template long long render_points<DoubleDouble>(View const &, DoubleDouble const *, DoubleDouble const *, int, Sample *, Estimate *);
+
+	/* Renders a batch of pixels given as offsets from the perturbation
+	 * reference, evaluates to the steps taken
+	 */
+	long long render_delta(View const &view, double const *dx, double const *dy, int n, Sample *samples)
+	{
+		int       iterations = view.iterations;
+		double    epsilon    = tolerance(view);
+		double    smooth     = smoothing(view);
+		long long executed   = 0;
+
+		for(int i = 0; i < n; ++i)
+		{
+			double norm;
+			int    period;
+			int    steps;
+			int    iter = perturbation::iterate(dx[i], dy[i], iterations, epsilon, &norm, &period, &steps);
+
+			samples[i] = sample(iter, norm, iterations, period, smooth);
+			executed  += steps;
+		}
+		return executed;
+	}
+}
@@ -1,17 +1,89 @@
-/* fractal.hh */
-#ifndef FRACTAL_HH
-#define FRACTAL_HH
-
-#define FRACTALS 1
-
-enum Fractal : int
-{
-	MANDELBROT = 0
-};
-
-namespace fractal 
-{
-	int render(long double, long double);
-}
-
-#endif /* FRACTAL_HH */
+/* fractal.hh */
+#ifndef FRACTAL_HH
+#define FRACTAL_HH
+
+#include <climits>
+#include "state.hh"
+
+#define FRACTALS 9
+
+#define SAMPLE_INVALID INT_MIN /* Pixel still to be computed */
+
+enum Fractal : int
+{
+	MANDELBROT   = 0,
+	MULTIBROT_3  = 1,
+	MULTIBROT_4  = 2,
+	MULTIBROT_5  = 3,
+	NEGABROT     = 4,
+	BURNING_SHIP = 5,
+	JULIA        = 6,
+	NEWTON       = 7,
+	NOVA         = 8,
+};
+
+/* What rendering a pixel leaves for the colouring pass. A provisional
+ * preview of a pixel still to be computed holds the complement of the
+ * iteration of the sample it was taken from
+ */
+struct Sample
+{
+	int   iter;  /* Escape iteration, the iteration limit inside the set */
+	float value; /* Smooth fraction escaped, period of the cycle inside */
+
+	bool operator ==(Sample const &sample) const
+	{
+		return this->iter == sample.iter && this->value == sample.value;
+	}
+
+	bool operator !=(Sample const &sample) const
+	{
+		return !(*this == sample);
+	}
+
+	/* Evaluates to true unless the sample is final
+	 */
+	bool pending(void) const
+	{
+		return this->iter < 0;
+	}
+
+	Sample preview(void) const
+	{
+		return this->iter >= 0 ? Sample{~this->iter, this->value} : *this;
+	}
+};
+
+/* The disk around a computed pixel that its distance estimate puts
+ * outside the set, with the gradient of the potential to interpolate the
+ * samples of the pixels in it
+ */
+struct Estimate
+{
+	float radius;    /* In pixels, 0 where there is no estimate */
+	float slope_x;   /* Relative change of the potential per pixel */
+	float slope_y;
+	float weight;    /* Smoothing of the sample over log 2, see fractal.cc */
+
+	/* The sample of the pixel x, y away from the estimated one. The
+	 * potential changes by less than half over the disk, where a series
+	 * of log(1 + u) is good to a hundredth of an iteration
+	 */
+	Sample at(Sample sample, int x, int y) const
+	{
+		float const u = this->slope_x * x + this->slope_y * y;
+		return {sample.iter, sample.value - this->weight * u * (1.0f - u * (0.5f - u * (1.0f / 3.0f)))};
+	}
+};
+
+namespace fractal 
+{
+	long long render_delta(View const &, double const *, double const *, int, Sample *);
+
+	template <typename T>
+	long long render_points(View const &, T const *, T const *, int, Sample *, Estimate * = nullptr);
+	void      paint(Sample const *, int *, int, int, int);
+	float     contrast(int, int);
+}
+
+#endif /* FRACTAL_HH */
@@ -1,104 +1,55 @@
-
-/* functions.cc */
-#include <cmath>
-#include <tuple>
-#include <complex>
-#include "functions.hh"
-
-#define DEVIATION_LIMIT    2.0L
-#define DEVIATION_LIMIT_SQ 4.0L
-
-namespace fractal 
-{
-	using val = std::tuple<int, std::complex<long double>>;
-
-	val mandelbrot(long double x, long double y, int iterations)
-	{
-		std::complex<long double> z{0.0L, 0.0L};
-		std::complex<long double> c{x,    y};
-		
-		int iter = 1;
-		do
-		{
-			z = z*z + c;
-			++iter;
-		}while(std::norm(z) <= DEVIATION_LIMIT_SQ && iter < iterations);
-
-		return {iter, z};
-	}
-/*
-	i32 multibrot(f80 x, f80 y, i32 exponent, i32 iterations)
-	{
-		const Complex<f80> c(x, y);
-		Complex<f80> z;
-
-		for(i32 i = 1; i < iterations; ++i)
-		{
-			//z = z.pow(exponent) + c;
-
-			if(z.norm() >= SQUARE(MANDELBROT_CONVERGENCE))
-				return i;
-		}
-
-		return iterations;
-	}
-
-	i32 negabrot(f80 x, f80 y, i32 exponent, i32 iterations)
-	{	
-		const Complex<f80> c(x, y);
-		Complex<f80> z;
-
-		for(u32 i = 1; i < iterations; ++i)
-		{
-			//z = z.exponentiate(exponent) + c;
-		
-				return i;
-		}
-
-		return iterations;
-	}
-
-	i32 julia(f80 x, f80 y, f80 r, f80 i, i32 iterations)
-	{
-		const Complex<f80> c(r, i);
-		Complex<f80> z(x, y);
-
-		for(i32 i = 1; i < iterations; ++i)
-		{
-			z = z.square() + c;
-
-			if(z.norm() >= SQUARE(MANDELBROT_CONVERGENCE))
-				return i;
-		}
-
-		return iterations;
-	}
-
-	i32 burning_ship(f80 x, f80 y, i32 iterations)
-	{
-		const Complex<f80> c(x, y);
-		Complex<f80> z;
-
-		for(u32 i = 1; i < iterations; ++i)
-		{
-			z.set(ABSOLUTE(z.real()), ABSOLUTE(z.imag()));
-			z = z.square() + c;
-
-			if(z.norm() >= SQUARE(MANDELBROT_CONVERGENCE))
-				return i;
-		}
-
-		return iterations;
-	}
-
-	i32 newton(f80 x, f80 y, i32 iterations, i32 type)
-	{
-		return 0;
-	}
-
-	i32 nova(f80 x, f80 y, i32 iterations)
-	{
-		return 0;
-	}*/
-}
-
+/* functions.cc */
+#include "functions.hh"
+
+#define JULIA_SEEDS 7
+
+namespace fractal
+{
+	static Formula const formulas[FRACTALS] = {
+		{"Mandelbrot",   1,           2, true,  Symmetry::CONJUGATE},
+		{"Multibrot 3",  1,           3, false, Symmetry::CONJUGATE},
+		{"Multibrot 4",  1,           4, false, Symmetry::CONJUGATE},
+		{"Multibrot 5",  1,           5, false, Symmetry::CONJUGATE},
+		{"Negabrot",     1,           0, false, Symmetry::CONJUGATE},
+		{"Burning ship", 1,           2, false, Symmetry::ASYMMETRIC},
+		{"Julia",        JULIA_SEEDS, 2, false, Symmetry::ROTATION},
+		{"Newton",       1,           0, false, Symmetry::CONJUGATE},
+		{"Nova",         1,           0, false, Symmetry::CONJUGATE},
+	};
+
+	static double const julia_seeds[JULIA_SEEDS][2] = {
+		{ 0.285,    0.01},
+		{-0.70176, -0.3842},
+		{-0.7269,   0.1889},
+		{ 0.279,    0.0},
+		{-0.624,    0.425},
+		{ 0.0,      1.0},
+		{-1.0,      0.0},
+	};
+
+	Formula const &formula(int fractal)
+	{
+		return formulas[fractal];
+	}
+
+	/* The constant of a fractal and its option, zero for all but Julia
+	 * sets
+	 */
+	void seed(int fractal, int variable, double *x, double *y)
+	{
+		*x = fractal == Fractal::JULIA ? julia_seeds[variable][0] : 0.0;
+		*y = fractal == Fractal::JULIA ? julia_seeds[variable][1] : 0.0;
+	}
+
+	/* Formulas with real coefficients commute with conjugation, so Julia
+	 * sets of a real constant are mirrored about the real axis as well
+	 */
+	int symmetry(int fractal, int variable)
+	{
+		double x, y;
+		seed(fractal, variable, &x, &y);
+
+		int const symmetric = formulas[fractal].symmetry;
+		return (symmetric & Symmetry::ROTATION) && y == 0.0 ? symmetric | Symmetry::CONJUGATE : symmetric;
+	}
+}
@@ -1,35 +1,333 @@
-
-/* functions.hh */
-#pragma once
-
-#include <tuple>
-#include <complex>
-
-/* Macro versions of fractal calls */
-#define Mandelbrot(x, y)   mandelbrot  (x, y, STATE::Iterations)
-#define Multibrot(x, y, p) multibrot   (x, y, p       , STATE::Iterations)
-#define Negabrot(x, y, p)  negabrot    (x, y, p       , STATE::Iterations)
-#define Burning_Ship(x, y) burning_ship(x,-y, STATE::Iterations)
-#define Julia_0(x, y)      julia       (x, y, 0.285L  , 0.01L   , STATE::Iterations)
-#define Julia_1(x, y)      julia       (x, y,-0.70176L, -0.3842L, STATE::Iterations)
-#define Julia_2(x, y)      julia       (x, y,-0.7269L , 0.1889L , STATE::Iterations)
-#define Julia_3(x, y)      julia       (x, y, 0.279L  , 0.0L    , STATE::Iterations)
-#define Julia_4(x, y)      julia       (x, y,-0.624L  , 0.425L  , STATE::Iterations)
-#define Julia_5(x, y)      julia       (x, y, 0.0L    , 1.0L    , STATE::Iterations);
-#define Julia_6(x, y)      julia       (x, y,-1.0L    , 0.0L    , STATE::Iterations);
-#define Newton(x, y, i)    newton      (x, y, i       , STATE::Iterations)
-#define Nova(x, y)         nova        (x, y, STATE::Iterations)
-
-namespace fractal 
-{
-	using val = std::tuple<int, std::complex<long double>>;
-
-	val mandelbrot(long double, long double, int);
-	/*i32 multibrot(f80, f80, i32, i32);
-	i32 negabrot(f80, f80, i32, i32);
-	i32 burning_ship(f80, f80, i32);
-	i32 julia(f80, f80, f80, f80, i32);
-	i32 newton(f80, f80, i32, i32);
-	i32 nova(f80, f80, i32); */
-}
-
+/* functions.hh */
+#ifndef FUNCTIONS_HH
+#define FUNCTIONS_HH
+
+#include "fractal.hh"
+
+/* The formulas of the fractals, each a policy the batch kernels are
+ * instantiated with (see algorithms.cc), so that every formula is inlined
+ * into kernels of its own for every number type and instruction set. A
+ * formula is written once against an arithmetic A, which computes on a
+ * vector of numbers (lanes of float or double, or of double-double pairs)
+ * as A::V. start() sets up the orbit of a pixel at x, y, given the seed of
+ * the fractal (the constant of a Julia set), as z and the constant k added
+ * on every iteration. step() iterates z once, given its squared parts
+ *
+ * Escaping formulas are done once |z|^2 reaches the escape radius,
+ * converging ones once z moves less than the cycle tolerance in a step.
+ * Only the Mandelbrot set has the analytic interior test, and converging
+ * formulas leave out cycle detection. Formulas whose set is connected,
+ * so that the distance estimate bounds the distance to it from below,
+ * have derive() to carry dz/dc along, given z before the step
+ */
+
+namespace fractal
+{
+	/* z * w
+	 */
+	template <typename A>
+	inline void multiply(typename A::V ar, typename A::V ai, typename A::V br, typename A::V bi, typename A::V &r, typename A::V &i)
+	{
+		typename A::V const real = A::sub(A::mul(ar, br), A::mul(ai, bi));
+		i = A::fmadd(ar, bi, A::mul(ai, br));
+		r = real;
+	}
+
+	/* z^P for a positive P by squaring, z^2 comes from the squared parts
+	 * the kernel keeps anyway
+	 */
+	template <int P, typename A>
+	inline void power(typename A::V zr, typename A::V zi, typename A::V zr2, typename A::V zi2, typename A::V &r, typename A::V &i)
+	{
+		static_assert(P >= 1, "Exponents are positive");
+
+		if constexpr(P == 1)
+		{
+			r = zr;
+			i = zi;
+		}
+		else if constexpr(P == 2)
+		{
+			r = A::sub(zr2, zi2);
+			i = A::mul(A::twice(zr), zi);
+		}
+		else if constexpr(P % 2 == 0)
+		{
+			typename A::V hr, hi;
+			power<P / 2, A>(zr, zi, zr2, zi2, hr, hi);
+			r = A::sub(A::square(hr), A::square(hi));
+			i = A::mul(A::twice(hr), hi);
+		}
+		else
+		{
+			typename A::V hr, hi;
+			power<P - 1, A>(zr, zi, zr2, zi2, hr, hi);
+			multiply<A>(hr, hi, zr, zi, r, i);
+		}
+	}
+
+	/* One step of Newton's method on z^3 - 1, (2z^3 + 1) / 3z^2
+	 */
+	template <typename A>
+	inline void newton(typename A::V &zr, typename A::V &zi, typename A::V zr2, typename A::V zi2)
+	{
+		typedef typename A::V V;
+
+		V const sr = A::sub(zr2, zi2);
+		V const si = A::mul(A::twice(zr), zi);
+		V cr, ci;
+		multiply<A>(sr, si, zr, zi, cr, ci);
+
+		// Numerator over the denominator times its conjugate
+		V const nr = A::add(A::twice(cr), A::set1(1));
+		V const ni = A::twice(ci);
+		V const dr = A::mul(A::set1(3), sr);
+		V const di = A::mul(A::set1(3), si);
+		V const inverse = A::div(A::set1(1), A::fmadd(dr, dr, A::square(di)));
+		zr = A::mul(A::fmadd(nr, dr, A::mul(ni, di)), inverse);
+		zi = A::mul(A::sub(A::mul(ni, dr), A::mul(nr, di)), inverse);
+	}
+
+	/* z^2 + c
+	 */
+	struct Mandelbrot
+	{
+		static bool const interior  = true;
+		static bool const converges = false;
+		static bool const estimates = true;
+
+		template <typename A>
+		static inline void start(typename A::V x, typename A::V y, typename A::V, typename A::V, typename A::V &zr, typename A::V &zi, typename A::V &kr, typename A::V &ki)
+		{
+			zr = zi = A::set1(0);
+			kr = x;
+			ki = y;
+		}
+
+		/* dz/dc as 2z dz/dc + 1
+		 */
+		template <typename A>
+		static inline void derive(typename A::V zr, typename A::V zi, typename A::V, typename A::V, typename A::V &dr, typename A::V &di)
+		{
+			typename A::V const real = A::add(A::twice(A::sub(A::mul(zr, dr), A::mul(zi, di))), A::set1(1));
+			di = A::twice(A::fmadd(zr, di, A::mul(zi, dr)));
+			dr = real;
+		}
+
+		template <typename A>
+		static inline void step(typename A::V &zr, typename A::V &zi, typename A::V zr2, typename A::V zi2, typename A::V kr, typename A::V ki)
+		{
+			zi = A::fmadd(A::twice(zr), zi, ki);
+			zr = A::add(A::sub(zr2, zi2), kr);
+		}
+	};
+
+	/* z^P + c
+	 */
+	template <int P>
+	struct Multibrot
+	{
+		static bool const interior  = false;
+		static bool const converges = false;
+		static bool const estimates = true;
+
+		template <typename A>
+		static inline void start(typename A::V x, typename A::V y, typename A::V, typename A::V, typename A::V &zr, typename A::V &zi, typename A::V &kr, typename A::V &ki)
+		{
+			zr = zi = A::set1(0);
+			kr = x;
+			ki = y;
+		}
+
+		/* dz/dc as P z^(P-1) dz/dc + 1
+		 */
+		template <typename A>
+		static inline void derive(typename A::V zr, typename A::V zi, typename A::V zr2, typename A::V zi2, typename A::V &dr, typename A::V &di)
+		{
+			typename A::V pr, pi;
+			power<P - 1, A>(zr, zi, zr2, zi2, pr, pi);
+			multiply<A>(pr, pi, dr, di, pr, pi);
+			dr = A::fmadd(A::set1(P), pr, A::set1(1));
+			di = A::mul(A::set1(P), pi);
+		}
+
+		template <typename A>
+		static inline void step(typename A::V &zr, typename A::V &zi, typename A::V zr2, typename A::V zi2, typename A::V kr, typename A::V ki)
+		{
+			typename A::V pr, pi;
+			power<P, A>(zr, zi, zr2, zi2, pr, pi);
+			zr = A::add(pr, kr);
+			zi = A::add(pi, ki);
+		}
+	};
+
+	/* z^-P + c, from z = c as z = 0 has no inverse
+	 */
+	template <int P>
+	struct Negabrot
+	{
+		static bool const interior  = false;
+		static bool const converges = false;
+		static bool const estimates = false;
+
+		template <typename A>
+		static inline void start(typename A::V x, typename A::V y, typename A::V, typename A::V, typename A::V &zr, typename A::V &zi, typename A::V &kr, typename A::V &ki)
+		{
+			zr = kr = x;
+			zi = ki = y;
+		}
+
+		template <typename A>
+		static inline void step(typename A::V &zr, typename A::V &zi, typename A::V zr2, typename A::V zi2, typename A::V kr, typename A::V ki)
+		{
+			typename A::V pr, pi;
+			power<P, A>(zr, zi, zr2, zi2, pr, pi);
+
+			typename A::V const inverse = A::div(A::set1(1), A::fmadd(pr, pr, A::square(pi)));
+			zr = A::fmadd(pr, inverse, kr);
+			zi = A::sub(ki, A::mul(pi, inverse));
+		}
+	};
+
+	/* (|Re z| + i|Im z|)^2 + c, upside down so that the ship floats
+	 */
+	struct BurningShip
+	{
+		static bool const interior  = false;
+		static bool const converges = false;
+		static bool const estimates = false;
+
+		template <typename A>
+		static inline void start(typename A::V x, typename A::V y, typename A::V, typename A::V, typename A::V &zr, typename A::V &zi, typename A::V &kr, typename A::V &ki)
+		{
+			zr = zi = A::set1(0);
+			kr = x;
+			ki = A::sub(A::set1(0), y);
+		}
+
+		template <typename A>
+		static inline void step(typename A::V &zr, typename A::V &zi, typename A::V zr2, typename A::V zi2, typename A::V kr, typename A::V ki)
+		{
+			zi = A::fmadd(A::twice(A::abs(zr)), A::abs(zi), ki);
+			zr = A::add(A::sub(zr2, zi2), kr);
+		}
+	};
+
+	/* z^2 + k from z = x + iy, for the constant k of the seed
+	 */
+	struct Julia
+	{
+		static bool const interior  = false;
+		static bool const converges = false;
+		static bool const estimates = false;
+
+		template <typename A>
+		static inline void start(typename A::V x, typename A::V y, typename A::V sx, typename A::V sy, typename A::V &zr, typename A::V &zi, typename A::V &kr, typename A::V &ki)
+		{
+			zr = x;
+			zi = y;
+			kr = sx;
+			ki = sy;
+		}
+
+		template <typename A>
+		static inline void step(typename A::V &zr, typename A::V &zi, typename A::V zr2, typename A::V zi2, typename A::V kr, typename A::V ki)
+		{
+			Mandelbrot::step<A>(zr, zi, zr2, zi2, kr, ki);
+		}
+	};
+
+	/* Newton's method on z^3 - 1 from z = x + iy
+	 */
+	struct Newton
+	{
+		static bool const interior  = false;
+		static bool const converges = true;
+		static bool const estimates = false;
+
+		template <typename A>
+		static inline void start(typename A::V x, typename A::V y, typename A::V, typename A::V, typename A::V &zr, typename A::V &zi, typename A::V &kr, typename A::V &ki)
+		{
+			zr = x;
+			zi = y;
+			kr = ki = A::set1(0);
+		}
+
+		template <typename A>
+		static inline void step(typename A::V &zr, typename A::V &zi, typename A::V zr2, typename A::V zi2, typename A::V, typename A::V)
+		{
+			newton<A>(zr, zi, zr2, zi2);
+		}
+	};
+
+	/* Newton's method on z^3 - 1 plus c, from the critical point z = 1
+	 */
+	struct Nova
+	{
+		static bool const interior  = false;
+		static bool const converges = true;
+		static bool const estimates = false;
+
+		template <typename A>
+		static inline void start(typename A::V x, typename A::V y, typename A::V, typename A::V, typename A::V &zr, typename A::V &zi, typename A::V &kr, typename A::V &ki)
+		{
+			zr = A::set1(1);
+			zi = A::set1(0);
+			kr = x;
+			ki = y;
+		}
+
+		template <typename A>
+		static inline void step(typename A::V &zr, typename A::V &zi, typename A::V zr2, typename A::V zi2, typename A::V kr, typename A::V ki)
+		{
+			newton<A>(zr, zi, zr2, zi2);
+			zr = A::add(zr, kr);
+			zi = A::add(zi, ki);
+		}
+	};
+
+	/* Every formula in the order of enum Fractal
+	 */
+	template <typename... F>
+	struct Formulas
+	{
+		static_assert(sizeof...(F) == FRACTALS, "A formula for every fractal");
+	};
+
+	typedef Formulas<Mandelbrot, Multibrot<3>, Multibrot<4>, Multibrot<5>, Negabrot<2>, BurningShip, Julia, Newton, Nova> Registry;
+
+	/* Whether a fractal has a distance estimate
+	 */
+	template <typename... F>
+	inline bool estimates(Formulas<F...>, int fractal)
+	{
+		static bool const estimating[] = {F::estimates...};
+		return estimating[fractal];
+	}
+
+	/* Symmetries of the plane a fractal is invariant under
+	 */
+	enum Symmetry : int
+	{
+		ASYMMETRIC = 0x0,
+		CONJUGATE  = 0x1, /* Mirrored about the real axis */
+		ROTATION   = 0x2, /* Rotated by 180 degrees about the origin */
+	};
+
+	/* What the rest of the renderer needs to know of a fractal
+	 */
+	struct Formula
+	{
+		char const *name;
+		int         variants;     /* Values of the fractal specific option */
+		int         degree;       /* Of escaping orbits for smooth colouring, 0 for none */
+		bool        perturbation; /* Deep views can be rendered by perturbation */
+		int         symmetry;     /* Symmetries of every variant */
+	};
+
+	Formula const &formula(int);
+	void           seed(int, int, double *, double *);
+	int            symmetry(int, int);
+}
+
+#endif /* FUNCTIONS_HH */
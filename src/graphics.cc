@@ -1,216 +1,207 @@
-/* graphics.cc */
-#include <cassert>
-#include <cstdio>
-#include <cstddef>
-#include <cstring>
-#include <ctime>
-#include <SDL2/SDL.h>
-#include "graphics.hh"
-#include "interface.hh"
-#include "process.hh"
-#include "state.hh"
-
-namespace graphics
-{
-	static SDL_Window   *window   = NULL;
-	static SDL_Renderer *renderer = NULL;
-	static SDL_Texture  *texture  = NULL;
-	static int          *vbuffer  = NULL;
-
-	void set_invalid(void)
-	{
-		std::memset(vbuffer, VALUE_INVALID, state.width * state.height * sizeof(int));
-	}
-
-	void initialize(void)
-	{
-		assert(SDL_Init(SDL_INIT_EVERYTHING) != -1);
-
-		window = SDL_CreateWindow
-		(
-			PROGRAM " v" VERSION,
-			SDL_WINDOWPOS_CENTERED,
-			SDL_WINDOWPOS_CENTERED,
-			state.width,
-			state.height,
-			SDL_WINDOW_RESIZABLE
-		);
-		assert(window != NULL);
-		resize();
-		interface::initialize();
-	}
-
-	void resize(void)
-	{
-		if(texture != NULL)
-			SDL_DestroyTexture(texture);
-		if(renderer != NULL)
-			SDL_DestroyRenderer(renderer);
-		if(vbuffer != NULL)
-			delete[] vbuffer;
-		
-		SDL_GetWindowSize(window, &state.width, &state.height); 
-
-		renderer = SDL_CreateRenderer
-		(
-			window,
-			-1,
-			SDL_RENDERER_ACCELERATED
-		);
-
-		assert(renderer != NULL);
-		texture = SDL_CreateTexture
-		(
-			renderer,
-			SDL_PIXELFORMAT_ARGB8888,
-			SDL_TEXTUREACCESS_STREAMING,
-			state.width, 	
-			state.height	
-		);
-		assert(texture != NULL);
-
-		vbuffer = new int[state.width * state.height];
-		assert(vbuffer != NULL);
-	}
-
-	void quit(void)
-	{
-		delete[] vbuffer;
-		interface::quit();
-		SDL_DestroyTexture(texture);
-		SDL_DestroyRenderer(renderer);
-		SDL_DestroyWindow(window);
-		SDL_Quit();
-	}
-
-	void toggle_fullscreen(void)
-	{
-		if(SDL_GetWindowFlags(window) & SDL_WINDOW_FULLSCREEN)
-			SDL_SetWindowFullscreen(window, 0);
-		else
-			SDL_SetWindowFullscreen(window, SDL_WINDOW_FULLSCREEN);
-	}
-
-	void screenshot(void)
-	{
-		SDL_Surface *shot;
-		char title[64];
-		int  length;
-		
-		shot = SDL_CreateRGBSurface
-		(
-			0,
-			state.width,
-			state.height,
-			32,
-			0x00FF0000,
-			0x0000FF00,
-			0x000000FF,
-			0xFF000000
-		);
-		assert(shot != NULL);
-		SDL_RenderReadPixels
-		(
-			renderer,
-			NULL,
-			SDL_PIXELFORMAT_ARGB8888,
-			shot->pixels,
-			shot->pitch
-		);
-		std::sprintf(title, "screenshots/%d.bmp%n", (int)std::time(NULL), &length);
-		SDL_SaveBMP(shot, title);
-		interface::push_format(-1, (state.height / 2) + 24, length, "Saved as %s", title);
-
-		SDL_FreeSurface(shot);
-	}
-	
-	void set_manual(int index, int color)
-	{
-		vbuffer[index] = color;
-	}
-
-	void set(int x, int y, int color)
-	{
-		set_manual(y * state.width + x, color);
-	}
-	
-	int color(int x, int y)
-	{
-		return vbuffer[y * state.width + x];
-	}
-
-	void clear(void)
-	{
-		SDL_RenderClear(renderer);
-	}
-
-	void load_interface(void)
-	{
-		interface::render(renderer);
-	}
-	
-	void load_pixels(void)
-	{
-		SDL_UpdateTexture
-		(
-			texture,
-			NULL,
-			vbuffer,
-			state.width * sizeof(int)
-		);
-		SDL_RenderCopy
-		(
-			renderer,
-			texture,
-			NULL, 
-			NULL
-		);
-	}
-
-	/* Shifts the video buffer according to how the coordinates moved
-	 * since last render
-	 */
-	void shift(void)
-	{
-		static long double px = 0;
-		static long double py = 0;
-		
-		const int dx = (state.x - px) * state.scale;
-		const int dy = (py - state.y) * state.scale;
-		
-		auto lambda = [=](int x, int y) -> void
-		{
-			const int rx = x + dx;
-			const int ry = y + dy;
-			if(rx < 0 || rx >= state.width || ry < 0 || ry >= state.height)
-				set(x, y, VALUE_INVALID);
-			else
-				set(x, y, color(rx, ry));
-		};
-		
-		for(int y  = (dy < 0 ? state.height-1 : 0)
-		   ;    y != (dy < 0 ? -1             : state.height)
-		   ;    y += (dy < 0 ? -1             : 1))
-		{
-			for(int x  = (dx < 0 ? state.width-1 : 0)
-			   ;    x != (dx < 0 ? -1            : state.width)
-			   ;    x += (dx < 0 ? -1            : 1))
-			{
-				lambda(x, y);
-			}
-		}
-
-		px = state.x;
-		py = state.y;
-	}
-
-	void post_process(void)
-	{
-
-	}
-
-	void refresh(void)
-	{
-		SDL_RenderPresent(renderer);
-	}
-}
+/* graphics.cc */
+#include <cassert>
+#include <cstdio>
+#include <cstddef>
+#include <ctime>
+#include <SDL2/SDL.h>
+#include "graphics.hh"
+#include "buffer.hh"
+#include "interface.hh"
+#include "process.hh"
+#include "state.hh"
+#include "stats.hh"
+
+namespace graphics
+{
+	static SDL_Window   *window   = NULL;
+	static SDL_Renderer *renderer = NULL;
+	static SDL_Texture  *texture  = NULL;
+
+
+	void initialize(void)
+	{
+		assert(SDL_Init(SDL_INIT_EVERYTHING) != -1);
+
+		window = SDL_CreateWindow
+		(
+			PROGRAM " v" VERSION,
+			SDL_WINDOWPOS_CENTERED,
+			SDL_WINDOWPOS_CENTERED,
+			state.width,
+			state.height,
+			SDL_WINDOW_RESIZABLE
+		);
+		assert(window != NULL);
+		resize();
+		interface::initialize();
+	}
+
+	static void create_texture(void)
+	{
+		texture = SDL_CreateTexture
+		(
+			renderer,
+			SDL_PIXELFORMAT_ARGB8888,
+			SDL_TEXTUREACCESS_STREAMING,
+			state.width, 	
+			state.height	
+		);
+		assert(texture != NULL);
+	}
+
+	void resize(void)
+	{
+		if(texture != NULL)
+			SDL_DestroyTexture(texture);
+		if(renderer != NULL)
+			SDL_DestroyRenderer(renderer);
+
+		SDL_GetWindowSize(window, &state.width, &state.height); 
+
+		renderer = SDL_CreateRenderer
+		(
+			window,
+			-1,
+			SDL_RENDERER_ACCELERATED
+		);
+
+		assert(renderer != NULL);
+		create_texture();
+
+		buffer::resize();
+	}
+
+	/* Makes the texture anew once the device lost it. Only changed rows
+	 * are painted into the texture, the others live on in it alone, so
+	 * every row is painted again
+	 */
+	void reset(void)
+	{
+		SDL_DestroyTexture(texture);
+		create_texture();
+		buffer::touch(0, state.height);
+	}
+
+	void quit(void)
+	{
+		buffer::free();
+		interface::quit();
+		SDL_DestroyTexture(texture);
+		SDL_DestroyRenderer(renderer);
+		SDL_DestroyWindow(window);
+		SDL_Quit();
+	}
+
+	void toggle_fullscreen(void)
+	{
+		if(SDL_GetWindowFlags(window) & SDL_WINDOW_FULLSCREEN)
+			SDL_SetWindowFullscreen(window, 0);
+		else
+			SDL_SetWindowFullscreen(window, SDL_WINDOW_FULLSCREEN);
+	}
+
+	void screenshot(void)
+	{
+		SDL_Surface *shot;
+		char title[64];
+		int  length;
+		
+		shot = SDL_CreateRGBSurface
+		(
+			0,
+			state.width,
+			state.height,
+			32,
+			0x00FF0000,
+			0x0000FF00,
+			0x000000FF,
+			0xFF000000
+		);
+		assert(shot != NULL);
+		SDL_RenderReadPixels
+		(
+			renderer,
+			NULL,
+			SDL_PIXELFORMAT_ARGB8888,
+			shot->pixels,
+			shot->pitch
+		);
+		std::sprintf(title, "screenshots/%d.bmp%n", (int)std::time(NULL), &length);
+		SDL_SaveBMP(shot, title);
+		interface::push_format(-1, (state.height / 2) + 24, length, "Saved as %s", title);
+
+		SDL_FreeSurface(shot);
+	}
+	
+	void clear(void)
+	{
+		SDL_RenderClear(renderer);
+	}
+
+	void load_interface(void)
+	{
+		interface::render(renderer);
+	}
+	
+	/* Paints the rows that changed since the last frame straight into the
+	 * streaming texture, the others keep what the texture holds. Every run
+	 * of changed rows is locked, painted, smoothed with its supersamples
+	 * if anti-aliasing and unlocked on its own, as SDL hands out write
+	 * only memory for the whole locked rectangle and uploads all of it.
+	 * SDL keeps the texture being shown apart from that memory, so the
+	 * upload on unlocking is the only copy of the rows
+	 */
+	void load_pixels(void)
+	{
+		int from, to = 0;
+
+		if(!buffer::dirty())
+			return;
+
+		stats::present();
+		while(buffer::dirty(to, &from, &to))
+		{
+			double start = stats::now();
+			void  *memory;
+			int    pitch;
+
+			SDL_Rect const rows = {0, from, state.width, to - from};
+			if(SDL_LockTexture(texture, &rows, &memory, &pitch) != 0)
+			{
+				buffer::touch(from, to);
+				return;
+			}
+			buffer::paint(process::iterations(), (int *)memory, pitch, from, to);
+			stats::span("paint", start);
+			if(state.antialias)
+			{
+				start = stats::now();
+				buffer::resolve(process::iterations(), (int *)memory, pitch, from, to);
+				stats::span("resolve", start);
+			}
+
+			start = stats::now();
+			SDL_UnlockTexture(texture);
+			stats::span("upload", start);
+		}
+	}
+
+	/* Shows the texture, rows not painted this frame show the last one
+	 * again
+	 */
+	void post_process(void)
+	{
+		SDL_RenderCopy
+		(
+			renderer,
+			texture,
+			NULL, 
+			NULL
+		);
+	}
+
+	void refresh(void)
+	{
+		SDL_RenderPresent(renderer);
+	}
+}
@@ -0,0 +1,236 @@
+/* headless/main.cc */
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <getopt.h>
+#include "../state.hh"
+#include "../process.hh"
+#include "../fractal.hh"
+#include "../functions.hh"
+#include "../buffer.hh"
+#include "../stats.hh"
+
+#define MAX_SIZE 0x4000
+
+/* Renders a single image without a window, through the same workers and
+ * fractals as the interactive program, and writes it as a binary PPM
+ */
+
+State state;
+
+static void usage(char const *);
+static bool parse_float(char const *, long double *);
+static bool parse_int(char const *, int, int, int *);
+static bool write_ppm(char const *);
+
+int main(int argc, char **argv)
+{
+	static option const options[] = {
+		{"real",       required_argument, NULL, 'x'},
+		{"imag",       required_argument, NULL, 'y'},
+		{"scale",      required_argument, NULL, 's'},
+		{"width",      required_argument, NULL, 'w'},
+		{"height",     required_argument, NULL, 'h'},
+		{"iterations", required_argument, NULL, 'i'},
+		{"fractal",    required_argument, NULL, 'f'},
+		{"variant",    required_argument, NULL, 'v'},
+		{"threads",    required_argument, NULL, 't'},
+		{"strategy",   required_argument, NULL, 'm'},
+		{"estimate",   no_argument,       NULL, 'e'},
+		{"antialias",  no_argument,       NULL, 'a'},
+		{"output",     required_argument, NULL, 'o'},
+		{"trace",      required_argument, NULL, 'T'},
+		{"help",       no_argument,       NULL, 'H'},
+		{NULL,         0,                 NULL, 0}
+	};
+	char const *output = "-";
+	char const *trace  = NULL;
+	bool        valid  = true;
+	int         option;
+
+	while((option = getopt_long(argc, argv, "x:y:s:w:h:i:f:v:t:m:eao:T:", options, NULL)) != -1)
+	{
+		switch(option)
+		{
+		case 'x':
+			valid = Fixed::parse(optarg, &state.x);
+			break;
+		case 'y':
+			valid = Fixed::parse(optarg, &state.y);
+			break;
+		case 's':
+			valid = parse_float(optarg, &state.scale)
+			     && state.scale >= MIN_SCALE && state.scale <= MAX_SCALE;
+			break;
+		case 'w':
+			valid = parse_int(optarg, 1, MAX_SIZE, &state.width);
+			break;
+		case 'h':
+			valid = parse_int(optarg, 1, MAX_SIZE, &state.height);
+			break;
+		case 'i':
+			valid = parse_int(optarg, MIN_ITERATIONS, MAX_ITERATIONS, &state.iterations);
+			break;
+		case 'f':
+			valid = parse_int(optarg, 0, FRACTALS - 1, &state.fractal);
+			break;
+		case 'v':
+			valid = parse_int(optarg, 0, INT_MAX, &state.variable);
+			break;
+		case 't':
+			valid = parse_int(optarg, MIN_THREADS, MAX_THREADS, &state.threads);
+			break;
+		case 'm':
+			valid = parse_int(optarg, 0, STRATEGIES - 1, &state.strategy);
+			break;
+		case 'e':
+			state.estimate = true;
+			break;
+		case 'a':
+			state.antialias = true;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'T':
+			trace = optarg;
+			break;
+		case 'H':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+
+		if(!valid)
+		{
+			std::fprintf(stderr, "%s: invalid value '%s' for -%c\n", argv[0], optarg, option);
+			return 1;
+		}
+	}
+
+	if(optind != argc)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	if(state.variable >= fractal::formula(state.fractal).variants)
+	{
+		std::fprintf(stderr, "%s: %s has no variant %d\n", argv[0], fractal::formula(state.fractal).name, state.variable);
+		return 1;
+	}
+
+	if(trace != NULL)
+		stats::trace_begin();
+
+	buffer::resize();
+	buffer::set_invalid();
+	process::setup_threads();
+	process::dispatch();
+	process::await();
+	process::quit();
+
+	double start = stats::now();
+	buffer::paint(process::iterations());
+	stats::span("paint", start);
+	if(state.antialias)
+	{
+		start = stats::now();
+		buffer::resolve(process::iterations());
+		stats::span("resolve", start);
+	}
+
+	if(trace != NULL && !stats::trace_end(trace))
+	{
+		std::fprintf(stderr, "%s: could not write '%s'\n", argv[0], trace);
+		buffer::free();
+		return 1;
+	}
+
+	valid = write_ppm(output);
+	buffer::free();
+	if(!valid)
+	{
+		std::fprintf(stderr, "%s: could not write '%s'\n", argv[0], output);
+		return 1;
+	}
+	return 0;
+}
+
+static void usage(char const *program)
+{
+	std::fprintf
+	(
+		stderr,
+		"Usage: %s [options]\n"
+		"  -x, --real <x>        Real part of the centre\n"
+		"  -y, --imag <y>        Imaginary part of the centre\n"
+		"  -s, --scale <s>       Zoom level, pixels per unit\n"
+		"  -w, --width <n>       Image width\n"
+		"  -h, --height <n>      Image height\n"
+		"  -i, --iterations <n>  Maximum iterations\n"
+		"  -f, --fractal <n>     Fractal index (0 to %d)\n"
+		"  -v, --variant <n>     Variant of the fractal, as the Julia set constant\n"
+		"  -t, --threads <n>     Worker threads\n"
+		"  -m, --strategy <n>    0 raster, 1 progressive, 2 subdivide\n"
+		"  -e, --estimate        Fill the exterior from distance estimates\n"
+		"  -a, --antialias       Supersample the pixels on edges\n"
+		"  -o, --output <file>   PPM image to write, - for stdout (default)\n"
+		"  -T, --trace <file>    Chrome trace of the render to write\n",
+		program,
+		FRACTALS - 1
+	);
+}
+
+static bool parse_float(char const *text, long double *value)
+{
+	char *end;
+	*value = std::strtold(text, &end);
+	return end != text && *end == '\0';
+}
+
+static bool parse_int(char const *text, int low, int high, int *value)
+{
+	char *end;
+	long  parsed = std::strtol(text, &end, 10);
+	if(end == text || *end != '\0' || parsed < low || parsed > high)
+		return false;
+
+	*value = parsed;
+	return true;
+}
+
+/* Writes the buffer as a binary PPM, converted a row at a time so the
+ * file is written in a few large blocks
+ */
+static bool write_ppm(char const *path)
+{
+	bool  console = std::strcmp(path, "-") == 0;
+	FILE *file    = console ? stdout : std::fopen(path, "wb");
+	if(file == NULL)
+		return false;
+
+	std::vector<unsigned char> row(state.width * 3);
+	int const *pixels = buffer::pixels();
+	bool       valid  = std::fprintf(file, "P6\n%d %d\n255\n", state.width, state.height) > 0;
+
+	for(int y = 0; y < state.height && valid; ++y)
+	{
+		for(int x = 0; x < state.width; ++x)
+		{
+			int const color = pixels[y * state.width + x];
+			row[3 * x + 0]  = color >> 16;
+			row[3 * x + 1]  = color >> 8;
+			row[3 * x + 2]  = color;
+		}
+		valid = std::fwrite(row.data(), 1, row.size(), file) == row.size();
+	}
+
+	if(console)
+		return std::fflush(file) == 0 && valid;
+	return std::fclose(file) == 0 && valid;
+}
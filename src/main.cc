@@ -1,51 +1,94 @@
-/* main.cc */
-#include "state.hh"
-#include "input.hh"
-#include "process.hh"
-#include "graphics.hh"
-
-State state;
-
-void handle_status(int);
-
-int main(int argc, char **argv)
-{
-	graphics::initialize();
-	
-	while(state.running)
-	{
-		input::poll();
-		
-		handle_status(state.status);
-		
-		graphics::clear();
-		graphics::load_pixels();
-		graphics::post_process();
-		graphics::load_interface();
-		graphics::refresh();					
-
-		state.status = Status::NONE;
-	}
-
-	process::await();
-	graphics::quit();
-	return 0;
-}
-
-void handle_status(int status)
-{
-	if(status & Status::DISPATCH_AWAIT)
-		process::await(); 
-	if(status & Status::TOGGLE_FULLSCREEN)
-		graphics::toggle_fullscreen(); 
-	if(status & Status::RESIZE)
-		graphics::resize(); 
-	if(status & Status::SETUP_THREADS)
-		process::setup_threads(); 
-	if(status & Status::CLEAR)
-		graphics::set_invalid(); 
-	if(status & Status::SHIFT)
-		graphics::shift(); 
-	if(status & Status::DISPATCH) 
-			process::dispatch(); 
-}
+/* main.cc */
+#include <pthread.h>
+#include <SDL2/SDL.h>
+#include "state.hh"
+#include "input.hh"
+#include "process.hh"
+#include "graphics.hh"
+#include "buffer.hh"
+
+#define FRAME_TIME 16  /* Least milliseconds between presented frames */
+#define IDLE_WAIT  100 /* Most milliseconds to wait for input when idle */
+
+State state;
+
+void handle_status(int);
+void cancel(void);
+
+int main(int argc, char **argv)
+{
+	Uint32 next     = 0;
+	bool   redraw   = true;
+	bool   was_busy = false;
+
+	graphics::initialize();
+	
+	/* Frames are only presented when something changed: input, rows the
+	 * workers finished or the overlay of a render in progress, and then
+	 * no more often than every FRAME_TIME. Idle, the loop sleeps on input
+	 */
+	while(state.running)
+	{
+		bool const   waiting = redraw || was_busy || buffer::dirty();
+		Uint32 const now     = SDL_GetTicks();
+		int const    timeout = waiting ? (SDL_TICKS_PASSED(now, next) ? 0 : (int)(next - now)) : IDLE_WAIT;
+
+		redraw |= input::poll(timeout);
+		redraw |= state.status != Status::NONE;
+		handle_status(state.status);
+		state.status = Status::NONE;
+
+		bool const busy = process::rendering();
+		if(!SDL_TICKS_PASSED(SDL_GetTicks(), next) || !(redraw || busy || was_busy || buffer::dirty()))
+			continue;
+
+		graphics::clear();
+		graphics::load_pixels();
+		graphics::post_process();
+		graphics::load_interface();
+		graphics::refresh();					
+
+		next     = SDL_GetTicks() + FRAME_TIME;
+		redraw   = false;
+		was_busy = busy;
+	}
+
+	process::quit();
+	graphics::quit();
+	return 0;
+}
+
+void handle_status(int status)
+{
+	if(status & (Status::DISPATCH_AWAIT | Status::DISPATCH))
+		cancel(); 
+	if(status & Status::TOGGLE_FULLSCREEN)
+		graphics::toggle_fullscreen(); 
+	if(status & Status::RESIZE)
+		graphics::resize(); 
+	if(status & Status::SETUP_THREADS)
+		process::setup_threads(); 
+	if(status & Status::CLEAR)
+		buffer::set_invalid(); 
+	if(status & Status::REPROJECT)
+		buffer::reproject(); 
+	if(status & Status::SHIFT)
+		buffer::shift(); 
+	if(status & Status::DISPATCH) 
+			process::dispatch(); 
+}
+
+/* Cancels the render in progress, keeping the window responsive while
+ * the workers drop their tiles
+ */
+void cancel(void)
+{
+	pthread_t poll;
+	bool flag = true;
+	pthread_create(&poll, NULL, input::freeze, &flag);
+
+	process::cancel();
+
+	flag = false;
+	pthread_join(poll, NULL);
+}
@@ -0,0 +1,217 @@
+/* perturbation.cc */
+#include <atomic>
+#include <cmath>
+#include <vector>
+#include "perturbation.hh"
+#include "complex.hh"
+
+#define ESCAPE_RADIUS_SQ 4.0
+#define BLA_EPSILON      0x1p-53
+
+namespace perturbation
+{
+	/* Bilinear step over a span of the reference orbit. For an offset dz
+	 * smaller than the validity radius r, the span advances it to
+	 *     dz' = a * dz + b * dc
+	 * to within BLA_EPSILON of the exact perturbation iteration
+	 */
+	struct Step
+	{
+		Complexlf a, b;
+		double    r;
+	};
+
+	static std::vector<Complexlf>         orbit;
+	static std::vector<std::vector<Step>> table;
+	static Fixed                          orbit_x     = 0;
+	static Fixed                          orbit_y     = 0;
+	static int                            orbit_iter  = 0;
+	static int                            orbit_limbs = 0;
+	static double                         table_dc    = -1.0;
+	static std::atomic<long long>         skip_count{0};
+
+	/* Iterates the reference point in the precision of T and stores the
+	 * orbit rounded to double, which is all the pixels need of it
+	 */
+	template <typename T>
+	static void compute_orbit(T const &x, T const &y, int iterations)
+	{
+		Complex<T> const c{x, y};
+		Complex<T>       z{0, 0};
+		T const          radius = ESCAPE_RADIUS_SQ;
+
+		orbit.clear();
+		orbit.push_back((Complexlf)z);
+		for(int i = 0; i < iterations && z.norm() < radius; ++i)
+		{
+			z = z.square() + c;
+			orbit.push_back((Complexlf)z);
+		}
+	}
+
+	/* Builds the bilinear approximation table for offsets |dc| <= dcmax.
+	 * Level 0 holds single iterations, every further level merges pairs of
+	 * the level below, so level k steps 2^k iterations at once
+	 */
+	static void compute_table(double dcmax)
+	{
+		int const length = (int)orbit.size() - 1;
+
+		table.clear();
+		table.emplace_back(length > 0 ? length : 0);
+		for(int m = 0; m < length; ++m)
+		{
+			Step &step = table[0][m];
+			step.a = orbit[m] + orbit[m];
+			step.b = {1, 0};
+			step.r = std::fmax(0.0, BLA_EPSILON * orbit[m].modulus() - dcmax) / (step.a.modulus() + 1.0);
+		}
+
+		while(table.back().size() > 1)
+		{
+			std::vector<Step> const &below = table.back();
+			std::vector<Step>        level(below.size() / 2);
+
+			for(std::size_t i = 0; i < level.size(); ++i)
+			{
+				Step const &x = below[2 * i];
+				Step const &y = below[2 * i + 1];
+				double const ax = x.a.modulus();
+				double const ry = ax > 0.0 ? (y.r - x.b.modulus() * dcmax) / ax : 0.0;
+
+				level[i].a = y.a * x.a;
+				level[i].b = y.a * x.b + y.b;
+				level[i].r = std::fmin(x.r, std::fmax(0.0, ry));
+			}
+			table.push_back(std::move(level));
+		}
+
+		table_dc = dcmax;
+	}
+
+	/* (Re)computes the reference orbit at the given centre for pixels up
+	 * to dcmax away, unless it is still valid from the previous dispatch.
+	 * The centre is cut down to the limbs that resolve dcmax. Must not be
+	 * called while workers are iterating
+	 */
+	void reference(Fixed const &x, Fixed const &y, int iterations, double dcmax)
+	{
+		int const limbs = Fixed::limbs(1.0L / dcmax);
+
+		if(orbit.empty() || x != orbit_x || y != orbit_y || iterations != orbit_iter || limbs > orbit_limbs)
+		{
+			compute_orbit<Fixed>(x.truncate(limbs), y.truncate(limbs), iterations);
+			orbit_x     = x;
+			orbit_y     = y;
+			orbit_iter  = iterations;
+			orbit_limbs = limbs;
+			table_dc    = -1.0;
+		}
+
+		if(dcmax != table_dc)
+			compute_table(dcmax);
+	}
+
+	/* Iterates the offset dz of a pixel c + dc from the reference orbit Z,
+	 *     dz' = (2Z + dz)dz + dc
+	 * jumping ahead with the longest valid bilinear step wherever one is
+	 * available. Whenever the full value Z + dz comes closer to zero than
+	 * dz itself, the offset is about to lose its precision against the
+	 * reference (a glitch). The pixel is then rebased onto the start of the
+	 * reference orbit with dz = Z + dz, which is also done when the
+	 * reference orbit escaped before the pixel did. Interior pixels are
+	 * caught by the same cycle detection as the direct kernels, applied to
+	 * the full value Z + dz. Leaves the steps taken, a bilinear one
+	 * counting once, in steps
+	 */
+	int iterate(double dx, double dy, int iterations, double tolerance, double *norm, int *period, int *steps)
+	{
+		Complexlf const dc{dx, dy};
+		Complexlf       dz{0, 0};
+		Complexlf       z{0, 0};
+		Complexlf       saved{0, 0};
+		int             found   = 0;
+		int             mark    = 0;
+		int             next    = 1;
+		int const       last    = (int)orbit.size() - 1;
+		int const       levels  = (int)table.size();
+		long long       skipped = 0;
+
+		int iter  = 0;
+		int m     = 0;
+		int taken = 0;
+		while(iter < iterations && z.norm() < ESCAPE_RADIUS_SQ)
+		{
+			int k = m == 0 ? 0 : std::min(__builtin_ctz(m), levels - 1);
+			for(; k > 0; --k)
+			{
+				if((m >> k) < (int)table[k].size()
+				&& iter + (1 << k) <= iterations
+				&& dz.norm() < table[k][m >> k].r * table[k][m >> k].r)
+				{
+					break;
+				}
+			}
+
+			if(k > 0)
+			{
+				Step const &step = table[k][m >> k];
+				dz       = step.a * dz + step.b * dc;
+				m       += 1 << k;
+				iter    += 1 << k;
+				skipped += 1 << k;
+			}
+			else
+			{
+				dz = (orbit[m] + orbit[m] + dz) * dz + dc;
+				m++;
+				iter++;
+			}
+			z = orbit[m] + dz;
+			taken++;
+
+			if((z - saved).norm() < tolerance * tolerance)
+			{
+				found = iter - mark;
+				iter  = iterations;
+			}
+			else if(iter >= next)
+			{
+				saved = z;
+				mark  = iter;
+				next  = iter < (1 << 30) ? 2 * iter : iterations;
+			}
+
+			if(z.norm() < dz.norm() || m == last)
+			{
+				dz = z;
+				m  = 0;
+			}
+		}
+
+		if(skipped != 0)
+			skip_count += skipped;
+		if(norm != nullptr)
+			*norm = z.norm();
+		if(period != nullptr)
+			*period = found;
+		if(steps != nullptr)
+			*steps = taken;
+		return iter;
+	}
+
+	int length(void)
+	{
+		return (int)orbit.size();
+	}
+
+	long long skipped(void)
+	{
+		return skip_count;
+	}
+
+	void reset(void)
+	{
+		skip_count = 0;
+	}
+}
@@ -0,0 +1,23 @@
+/* perturbation.hh */
+#ifndef PERTURBATION_HH
+#define PERTURBATION_HH
+
+#include "fixed.hh"
+
+/* Deep zoom rendering by perturbation theory. A single reference orbit is
+ * computed at the view centre in fixed point, to as many limbs as the
+ * depth of the view needs, every
+ * pixel then only iterates its (tiny) distance to that orbit in double.
+ * Bilinear approximations of spans of the orbit let pixels skip ahead by
+ * many iterations at once while their distance is small enough
+ */
+namespace perturbation
+{
+	void      reference(Fixed const &, Fixed const &, int, double);
+	int       iterate(double, double, int, double, double *, int *, int *);
+	int       length(void);
+	long long skipped(void);
+	void      reset(void);
+}
+
+#endif /* PERTURBATION_HH */
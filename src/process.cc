@@ -1,115 +1,1217 @@
-/* process.cc */
-#include <cstring>
-#include <cstddef>
-#include <ctime>
-#include <cmath>
-#include <pthread.h>
-#include <vector>
-#include "process.hh"
-#include "input.hh"
-#include "state.hh"
-#include "graphics.hh"
-#include "fractal.hh"
-
-namespace process 
-{
-	struct ThreadData
-	{
-		pthread_t thread;
-		int x, y;
-		int width, height;
-	};
-	
-	static ThreadData   threads[MAX_THREADS];
-	static volatile int active = 0;
-
-	static void *process_segment(void *);
-	
-	/* Await all the dispatched threads to finish
-	 */
-	void await(void)
-	{
-		pthread_t poll;
-		bool flag = true;
-		pthread_create(&poll, NULL, input::freeze, &flag);
-		for(int i = 0; i < active; ++i)
-		{
-			pthread_join(threads[i].thread, NULL);
-		}
-		flag = false;
-		pthread_join(poll, NULL);
-	}
-
-	/* Assign every thread a rectangular segment of the screen
-	 * of a size depending on how many threads are used
-	 */
-	void setup_threads(void)
-	{
-		// Thread array needs to be zeroed in order to prevent segfaults
-		std::memset(threads, 0L, MAX_THREADS * sizeof(ThreadData));
-
-		active = state.threads;
-		int segments = std::sqrt(active);
-		int segw = state.width  / segments;
-		int segh = state.height / segments;
-
-		for(int y = 0, i = 0; y < segments; ++y)
-		{
-			for(int x = 0; x < segments; ++x, ++i)
-			{
-				threads[i].x      = x * segw;
-				threads[i].width  = segw;
-				threads[i].y      = y * segh;
-				threads[i].height = segh;
-			}
-		}
-	}
-	
-	/* Dispatches all threads, allowing them to work on their assigned
-	 * segments
-	 */
-	void dispatch(void)
-	{
-		await();
-		for(int i = 0; i < active; ++i)
-		{
-			pthread_create(&threads[i].thread, NULL, process_segment, &threads[i]);
-		}
-	}
-
-	/* Processes a single segment and writes to video buffer
-	 */
-	static void *process_segment(void *argp)
-	{
-		const ThreadData *thread   = (ThreadData *)argp;
-		const int         x_offset = thread->x - (state.width / 2);
-		const int         y_offset = (state.height / 2) - thread->y;
-		long double       x_coord[thread->width];
-		long double       y_coord[thread->height];
-
-		// Preload x coordinates
-		for(int x = 0; x < thread->width; ++x)
-		{
-			x_coord[x] = state.x + (long double)(x_offset + x) / state.scale;
-		}
-		// Preload y coordinates
-		for(int y = 0; y < thread->height; ++y)
-		{
-			y_coord[y] =  state.y + (long double)(y_offset - y) / state.scale;
-		}
-		
-		for(int y = thread->y, j = 0; y < thread->y + thread->height; ++y, ++j)
-		{
-			for(int x = thread->x, i = 0; x < thread->x + thread->width; ++x, ++i)
-			{
-				if(graphics::color(x, y) == VALUE_INVALID)
-				{
-					int color = fractal::render(x_coord[i], y_coord[j]);
-					graphics::set_manual(y * state.width + x, color);
-				}
-			}
-		}
-
-		pthread_exit(NULL);
-	}
-}
+/* process.cc */
+#include <cstddef>
+#include <ctime>
+#include <cmath>
+#include <cfloat>
+#include <limits>
+#include <type_traits>
+#include <atomic>
+#include <deque>
+#include <algorithm>
+#include <pthread.h>
+#include <vector>
+#include "process.hh"
+#include "state.hh"
+#include "buffer.hh"
+#include "fractal.hh"
+#include "functions.hh"
+#include "perturbation.hh"
+#include "cache.hh"
+#include "stats.hh"
+#include "doubledouble.hh"
+
+#define TILE_SIZE          32
+#define PROGRESSIVE_STEP   16
+#define PROGRESSIVE_PASSES 5
+#define SUBDIVIDE_MIN      4
+#define BATCH_SIZE         (TILE_SIZE * 4)
+#define DISK_RADIUS        (TILE_SIZE / 2) /* Most pixels an exterior disk is filled out to */
+#define EDGE_BATCH         (BATCH_SIZE / SUPERSAMPLES)
+
+namespace process 
+{
+	/* A tile of the screen, aligned to the grid of the global quadtree
+	 * when the job is cacheable. The grid square it lies in starts at the
+	 * (possibly off screen) pixel ox, oy and is tile tx, ty of its level
+	 */
+	struct Tile
+	{
+		int       x, y;
+		int       width, height;
+		int       ox, oy;
+		long long tx, ty;
+	};
+
+	/* Every worker owns a deque of tile indices. The owner takes work from
+	 * the back, idle workers steal from the front of other deques
+	 */
+	struct Worker
+	{
+		pthread_t       thread;
+		pthread_mutex_t lock;
+		std::deque<int> queue;
+		int             index;
+	};
+
+	static Worker            workers[MAX_THREADS];
+	static std::vector<Tile> tiles;
+	static std::vector<int>  todo;
+	static int               origin_x = 0;
+	static int               origin_y = 0;
+
+	/* Tiles every pixel of which is final, and those whose edges are
+	 * supersampled (for colour shade), as of the epoch of the buffer. The
+	 * next job skips them unless the samples moved since
+	 */
+	static std::vector<char> rendered;
+	static std::vector<char> smoothed;
+	static unsigned          epoch = 0;
+	static int               shade = 0;
+	static int               active   = 0;
+
+	/* The job being rendered. Written only by dispatch() while no worker
+	 * holds a tile, a newer generation makes workers drop their tile
+	 */
+	static View                   job;
+	static Precision              number  = Precision::DOUBLE;
+	static bool                   cached  = false;
+	static int                    level   = 0;
+	static int                    pass    = 0;
+	static int                    passes  = 1;
+	static int                    renders = 1; /* Passes before the one supersampling edges */
+	static std::atomic<unsigned>  generation{0};
+
+	/* The view centre rounded for the sums of pixel coordinates */
+	static long double            centre_x = 0.0L;
+	static long double            centre_y = 0.0L;
+	static DoubleDouble           pairs_x;
+	static DoubleDouble           pairs_y;
+
+	/* Symmetries of the job that map its pixel grid onto itself, with the
+	 * sums of the coordinates of a pixel and its image
+	 */
+	static int                    mirrors  = 0;
+	static int                    mirror_x = 0;
+	static int                    mirror_y = 0;
+
+	/* Difference of samples outside the set that makes an edge */
+	static float                  contrast = 0.0f;
+
+	/* The generation of the job that last computed each pixel. Only
+	 * samples computed by the current job are exact, any other may be a
+	 * guess, an estimate or left from an older view
+	 */
+	static std::vector<std::atomic<unsigned>> computed;
+
+	/* Dispatch bookkeeping, guarded by the pool lock */
+	static pthread_mutex_t   pool_lock = PTHREAD_MUTEX_INITIALIZER;
+	static pthread_cond_t    pool_wake = PTHREAD_COND_INITIALIZER;
+	static pthread_cond_t    pool_idle = PTHREAD_COND_INITIALIZER;
+	static unsigned          round     = 0;
+	static bool              stopping  = false;
+	static bool              working   = false;
+	static std::atomic<int>  pending{0};
+
+	static void *work(void *);
+	static bool  take(Worker *, int *);
+	static bool  process_tile(Tile const &);
+	static void  settle(int);
+	static bool  needs_work(Sample);
+	static void  image(int, int, int *, int *);
+	static void  layout(long long, long long);
+	static bool  load(Tile const &);
+	static void  store(Tile const &);
+	static void  deal(void);
+	static void  unsmoothed(void);
+	static void  finish(int);
+	static Precision select_precision(View const &);
+	static bool  cacheable(View const &, int *);
+	static int   symmetric(View const &, int *, int *);
+	static void  stop_threads(void);
+	
+	/* Await the dispatched job to finish (or to be abandoned)
+	 */
+	void await(void)
+	{
+		pthread_mutex_lock(&pool_lock);
+		while(working)
+			pthread_cond_wait(&pool_idle, &pool_lock);
+		pthread_mutex_unlock(&pool_lock);
+	}
+
+	/* Start the worker pool with as many threads as requested
+	 */
+	void setup_threads(void)
+	{
+		if(active != state.threads)
+		{
+			stop_threads();
+
+			active = state.threads;
+			for(int i = 0; i < active; ++i)
+			{
+				workers[i].index = i;
+				pthread_mutex_init(&workers[i].lock, NULL);
+				pthread_create(&workers[i].thread, NULL, work, &workers[i]);
+			}
+		}
+	}
+
+	/* Cuts the screen into tiles on the grid of global pixels, given the
+	 * global pixel at the top left corner of the screen. The first and last
+	 * row and column of tiles take whatever of the grid is on screen
+	 */
+	static void layout(long long gx, long long gy)
+	{
+		int const ox = ((-gx % TILE_SIZE) + TILE_SIZE) % TILE_SIZE;
+		int const oy = ((-gy % TILE_SIZE) + TILE_SIZE) % TILE_SIZE;
+
+		origin_x = ox;
+		origin_y = oy;
+		tiles.clear();
+		for(int y = oy > 0 ? oy - TILE_SIZE : 0; y < job.height; y += TILE_SIZE)
+		{
+			for(int x = ox > 0 ? ox - TILE_SIZE : 0; x < job.width; x += TILE_SIZE)
+			{
+				Tile tile;
+				tile.x      = std::max(x, 0);
+				tile.y      = std::max(y, 0);
+				tile.width  = std::min(x + TILE_SIZE, job.width)  - tile.x;
+				tile.height = std::min(y + TILE_SIZE, job.height) - tile.y;
+				tile.ox     = x;
+				tile.oy     = y;
+				tile.tx     = (gx + x) / TILE_SIZE;
+				tile.ty     = (gy + y) / TILE_SIZE;
+				tiles.push_back(tile);
+			}
+		}
+	}
+
+	static cache::Key key(Tile const &tile)
+	{
+		return {job.fractal, job.iterations, job.variable, job.estimate, job.strategy, level, tile.tx, tile.ty};
+	}
+
+	/* Fills the on screen part of a tile from the cache, if it is there
+	 */
+	static bool load(Tile const &tile)
+	{
+		Sample samples[TILE_SIZE * TILE_SIZE];
+		if(!cache::load(key(tile), samples, TILE_SIZE * TILE_SIZE))
+			return false;
+
+		for(int y = tile.y; y < tile.y + tile.height; ++y)
+		{
+			for(int x = tile.x; x < tile.x + tile.width; ++x)
+				buffer::set(x, y, samples[(y - tile.oy) * TILE_SIZE + (x - tile.ox)]);
+		}
+		buffer::touch(tile.y, tile.y + tile.height);
+		return true;
+	}
+
+	/* Caches a tile that is entirely on screen and finished
+	 */
+	static void store(Tile const &tile)
+	{
+		Sample samples[TILE_SIZE * TILE_SIZE];
+		if(tile.width != TILE_SIZE || tile.height != TILE_SIZE)
+			return;
+
+		for(int y = 0; y < TILE_SIZE; ++y)
+		{
+			for(int x = 0; x < TILE_SIZE; ++x)
+			{
+				Sample const sample = buffer::sample(tile.x + x, tile.y + y);
+				if(sample.pending() || generation != job.generation)
+					return;
+				samples[y * TILE_SIZE + x] = sample;
+			}
+		}
+		cache::store(key(tile), samples, TILE_SIZE * TILE_SIZE);
+	}
+
+	/* Whether a job is being rendered
+	 */
+	bool rendering(void)
+	{
+		pthread_mutex_lock(&pool_lock);
+		bool const busy = working;
+		pthread_mutex_unlock(&pool_lock);
+		return busy;
+	}
+
+	/* The number type the current job is computed in
+	 */
+	Precision precision(void)
+	{
+		return number;
+	}
+
+	/* The iteration limit of the current job, which its samples are
+	 * coloured against, that of the state until a job is dispatched
+	 */
+	int iterations(void)
+	{
+		return job.generation != 0 ? job.iterations : state.iterations;
+	}
+
+	char const *precision_name(Precision precision)
+	{
+		static char const *const names[PRECISIONS] = {"float", "double", "long double", "double-double", "perturbation"};
+		return names[(int)precision];
+	}
+
+	/* Abandons the current job. Tiles not yet taken are dropped, tiles in
+	 * progress are dropped by their worker at the next row, so this only
+	 * waits for a few rows at most
+	 */
+	void cancel(void)
+	{
+		generation++;
+		for(int i = 0; i < active; ++i)
+		{
+			pthread_mutex_lock(&workers[i].lock);
+			int dropped = workers[i].queue.size();
+			workers[i].queue.clear();
+			pthread_mutex_unlock(&workers[i].lock);
+
+			finish(dropped);
+		}
+		await();
+	}
+
+	/* Snapshots the view as a new job, fills in the tiles the cache holds
+	 * and hands out the first pass of the others. Returns without waiting
+	 * for the render
+	 */
+	void dispatch(void)
+	{
+		cancel();
+		job      = state.view(++generation);
+		number   = select_precision(job);
+		cached   = cacheable(job, &level);
+		centre_x = (long double)job.x;
+		centre_y = (long double)job.y;
+		pairs_x  = (DoubleDouble)job.x;
+		pairs_y  = (DoubleDouble)job.y;
+		mirrors  = symmetric(job, &mirror_x, &mirror_y);
+		if((int)computed.size() != job.width * job.height)
+			computed = std::vector<std::atomic<unsigned>>(job.width * job.height);
+		contrast = fractal::contrast(job.iterations, job.color);
+		perturbation::reset();
+		cache::budget((std::size_t)state.cache << 20);
+		stats::begin(job.width * job.height, active);
+
+		int const ox = origin_x;
+		int const oy = origin_y;
+		if(cached)
+		{
+			long long const gx = (long long)(long double)(job.x * Fixed(job.scale)) - job.width  / 2;
+			long long const gy = -(long long)(long double)(job.y * Fixed(job.scale)) - job.height / 2;
+			layout(gx, gy);
+		}
+		else
+		{
+			layout(0, 0);
+		}
+
+		if(epoch != buffer::epoch() || ox != origin_x || oy != origin_y || rendered.size() != tiles.size())
+		{
+			epoch = buffer::epoch();
+			rendered.assign(tiles.size(), false);
+			smoothed.assign(tiles.size(), false);
+		}
+		if(shade != job.color)
+		{
+			shade = job.color;
+			smoothed.assign(tiles.size(), false);
+		}
+
+		todo.clear();
+		for(int i = 0; i < (int)tiles.size(); ++i)
+		{
+			if(rendered[i])
+				continue;
+			if(cached && load(tiles[i]))
+				rendered[i] = true;
+			else
+				todo.push_back(i);
+		}
+
+		// The cache holds samples only, edges are supersampled anew
+		pass    = 0;
+		renders = job.strategy == Strategy::PROGRESSIVE ? PROGRESSIVE_PASSES : 1;
+		passes  = renders + job.antialias;
+		if(todo.empty())
+			pass = renders, unsmoothed();
+		if(todo.empty())
+		{
+			stats::complete();
+			return;
+		}
+
+		if(number == Precision::PERTURBATION)
+		{
+			long double radius = std::hypot(job.width, job.height) / (2.0L * job.scale);
+			perturbation::reference(job.x, job.y, job.iterations, radius);
+		}
+
+		pthread_mutex_lock(&pool_lock);
+		working = true;
+		pthread_mutex_unlock(&pool_lock);
+		deal();
+	}
+
+	/* Every tile whose edges are not supersampled yet is left for the
+	 * pass that does, when anti-aliasing. Edges may lie along the borders
+	 * of cached tiles as well
+	 */
+	static void unsmoothed(void)
+	{
+		todo.clear();
+		for(int i = 0; i < (int)tiles.size() && job.antialias; ++i)
+		{
+			if(!smoothed[i])
+				todo.push_back(i);
+		}
+	}
+
+	/* Deals every tile left to render out to the workers for the current
+	 * pass and wakes them up. Neighbouring tiles go to different workers
+	 * so that expensive regions are shared. Tiles mirrored from others go
+	 * to the front of the queues, owners take from the back, so that the
+	 * tiles they mirror are mostly done and lend them their samples
+	 */
+	static void deal(void)
+	{
+		std::stable_partition(todo.begin(), todo.end(), [](int index)
+		{
+			Tile const &tile = tiles[index];
+			int const   x    = tile.x + tile.width / 2;
+			int const   y    = tile.y + tile.height / 2;
+			int         ix, iy;
+			image(x, y, &ix, &iy);
+			return ix != x || iy != y;
+		});
+
+		pending = todo.size();
+		for(int i = 0; i < active; ++i)
+		{
+			pthread_mutex_lock(&workers[i].lock);
+			workers[i].queue.clear();
+			for(int j = i; j < (int)todo.size(); j += active)
+			{
+				workers[i].queue.push_back(todo[j]);
+			}
+			pthread_mutex_unlock(&workers[i].lock);
+		}
+
+		pthread_mutex_lock(&pool_lock);
+		round++;
+		pthread_cond_broadcast(&pool_wake);
+		pthread_mutex_unlock(&pool_lock);
+	}
+
+	/* Stops and joins every worker of the pool
+	 */
+	void quit(void)
+	{
+		cancel();
+		stop_threads();
+	}
+
+	static void stop_threads(void)
+	{
+		pthread_mutex_lock(&pool_lock);
+		stopping = true;
+		pthread_cond_broadcast(&pool_wake);
+		pthread_mutex_unlock(&pool_lock);
+
+		for(int i = 0; i < active; ++i)
+		{
+			pthread_join(workers[i].thread, NULL);
+			pthread_mutex_destroy(&workers[i].lock);
+		}
+
+		stopping = false;
+		active   = 0;
+	}
+
+	/* Worker thread, sleeps until the next dispatch and then processes
+	 * tiles until there are none left to take
+	 */
+	static void *work(void *argp)
+	{
+		Worker  *self = (Worker *)argp;
+		unsigned seen = 0;
+
+		for(;;)
+		{
+			pthread_mutex_lock(&pool_lock);
+			while(seen == round && !stopping)
+				pthread_cond_wait(&pool_wake, &pool_lock);
+			seen = round;
+			pthread_mutex_unlock(&pool_lock);
+
+			if(stopping)
+				break;
+
+			int tile;
+			while(take(self, &tile))
+			{
+				Tile const  &current = tiles[tile];
+				double const start   = stats::now();
+
+				if(process_tile(current))
+					settle(tile);
+				if(cached && pass == renders - 1)
+					store(current);
+				stats::tile(self->index, start, current.x, current.y, current.width, current.height, pass);
+				finish(1);
+			}
+		}
+
+		pthread_exit(NULL);
+	}
+
+	/* Marks tiles as done (or dropped). Once none are left, the worker that
+	 * finished the last one deals out the next pass, or wakes up whoever
+	 * awaits the job
+	 */
+	static void finish(int count)
+	{
+		if(count == 0 || (pending -= count) != 0)
+			return;
+
+		if(generation == job.generation && ++pass < passes)
+		{
+			if(pass == renders)
+				unsmoothed();
+			if(!todo.empty())
+			{
+				deal();
+				return;
+			}
+		}
+		if(generation == job.generation)
+			stats::complete();
+
+		pthread_mutex_lock(&pool_lock);
+		working = false;
+		pthread_cond_broadcast(&pool_idle);
+		pthread_mutex_unlock(&pool_lock);
+	}
+
+	/* Takes a tile from the back of the worker's own deque, or steals one
+	 * from the front of another worker's
+	 */
+	static bool take(Worker *self, int *tile)
+	{
+		for(int i = 0; i < active; ++i)
+		{
+			Worker *victim = &workers[(self->index + i) % active];
+			bool    found  = false;
+
+			pthread_mutex_lock(&victim->lock);
+			if(!victim->queue.empty())
+			{
+				if(victim == self)
+				{
+					*tile = victim->queue.back();
+					victim->queue.pop_back();
+				}
+				else
+				{
+					*tile = victim->queue.front();
+					victim->queue.pop_front();
+				}
+				found = true;
+			}
+			pthread_mutex_unlock(&victim->lock);
+
+			if(found)
+				return true;
+		}
+		return false;
+	}
+
+	/* A pixel needs to be computed unless it holds a final sample
+	 */
+	static bool needs_work(Sample sample)
+	{
+		return sample.pending();
+	}
+
+	/* Pixel coordinates are summed from the view centre in long double and
+	 * rounded to T, double-double sums them itself as it holds more than a
+	 * long double does
+	 */
+	template <typename T>
+	using Sum = typename std::conditional<std::is_same<T, DoubleDouble>::value, DoubleDouble, long double>::type;
+
+	/* Computes the points at the given (fractional) pixels, at most a
+	 * batch of them, in the number type T, with their exterior disks if
+	 * the job estimates distances and there are estimates to fill in.
+	 * Coordinates are relative to the reference orbit when rendering by
+	 * perturbation, which estimates none. Evaluates to the iterations run
+	 */
+	template <typename T>
+	static long long compute_in(double const *xs, double const *ys, int n, Sample *samples, Estimate *estimates)
+	{
+		bool const relative = number == Precision::PERTURBATION;
+		Sum<T>     x_origin = 0;
+		Sum<T>     y_origin = 0;
+		T          x_coord[BATCH_SIZE];
+		T          y_coord[BATCH_SIZE];
+
+		if constexpr(std::is_same<T, DoubleDouble>::value)
+			x_origin = pairs_x, y_origin = pairs_y;
+		else if(!relative)
+			x_origin = centre_x, y_origin = centre_y;
+
+		for(int i = 0; i < n; ++i)
+		{
+			x_coord[i] = (T)(x_origin + Sum<T>((long double)(xs[i] - (job.width / 2)) / job.scale));
+			y_coord[i] = (T)(y_origin + Sum<T>((long double)((job.height / 2) - ys[i]) / job.scale));
+		}
+
+		if constexpr(std::is_same<T, double>::value)
+		{
+			if(relative)
+			{
+				for(int i = 0; i < n && estimates != nullptr; ++i)
+					estimates[i].radius = 0.0f;
+				return fractal::render_delta(job, x_coord, y_coord, n, samples);
+			}
+		}
+		return fractal::render_points<T>(job, x_coord, y_coord, n, samples, estimates);
+	}
+
+	/* Computes the points in the number type of the job
+	 */
+	static long long compute_points(double const *xs, double const *ys, int n, Sample *samples, Estimate *estimates)
+	{
+		switch(number)
+		{
+		case Precision::SINGLE:
+			return compute_in<float>(xs, ys, n, samples, estimates);
+		case Precision::EXTENDED:
+			return compute_in<long double>(xs, ys, n, samples, estimates);
+		case Precision::PAIRS:
+			return compute_in<DoubleDouble>(xs, ys, n, samples, estimates);
+		default:
+			return compute_in<double>(xs, ys, n, samples, estimates);
+		}
+	}
+
+	/* Fills the pixels still to be computed in the exterior disk of a
+	 * computed one, up to DISK_RADIUS pixels out. The disk is clipped to
+	 * the tile, as no other worker writes those pixels: what a disk fills
+	 * does not depend on how the workers interleave. Returns the amount
+	 * filled
+	 */
+	static int fill_disk(Tile const &tile, int x, int y, Sample sample, Estimate const &estimate)
+	{
+		float const radius = std::fmin(estimate.radius, DISK_RADIUS);
+		int const   rows   = (int)radius;
+		int         filled = 0;
+
+		for(int j = std::max(-rows, tile.y - y); j <= rows && y + j < tile.y + tile.height; ++j)
+		{
+			int const half = (int)std::sqrt(radius * radius - (float)(j * j));
+			for(int i = std::max(-half, tile.x - x); i <= half && x + i < tile.x + tile.width; ++i)
+			{
+				if(needs_work(buffer::sample(x + i, y + j)))
+				{
+					buffer::set(x + i, y + j, estimate.at(sample, i, j));
+					filled++;
+				}
+			}
+		}
+		return filled;
+	}
+
+	/* The pixel a pixel is computed as: of its images under the
+	 * symmetries of the job that are on screen, the first in row order
+	 */
+	static void image(int x, int y, int *ix, int *iy)
+	{
+		int const candidates[3][2] = {
+			{x, mirror_y - y},
+			{mirror_x - x, mirror_y - y},
+			{mirror_x - x, y},
+		};
+		int const usable[3] = {
+			mirrors & fractal::Symmetry::CONJUGATE,
+			mirrors & fractal::Symmetry::ROTATION,
+			mirrors == (fractal::Symmetry::CONJUGATE | fractal::Symmetry::ROTATION),
+		};
+
+		*ix = x;
+		*iy = y;
+		for(int i = 0; i < 3; ++i)
+		{
+			int const cx = candidates[i][0];
+			int const cy = candidates[i][1];
+			if(usable[i] && cx >= 0 && cx < job.width && cy >= 0 && cy < job.height && (cy < *iy || (cy == *iy && cx < *ix)))
+			{
+				*ix = cx;
+				*iy = cy;
+			}
+		}
+	}
+
+	/* Whether a pixel lies in the tile
+	 */
+	static bool owns(Tile const &tile, int x, int y)
+	{
+		return x >= tile.x && x < tile.x + tile.width && y >= tile.y && y < tile.y + tile.height;
+	}
+
+	/* Keeps a sample the job computed for a pixel. Set after the sample,
+	 * so that whoever finds the pixel computed finds its sample too
+	 */
+	static void set_computed(int x, int y, Sample sample)
+	{
+		buffer::set(x, y, sample);
+		computed[y * job.width + x].store(job.generation, std::memory_order_release);
+	}
+
+	/* Takes the sample of an image of a pixel of the tile if it can stand
+	 * in for the pixel. In the tile every final sample does. From other
+	 * tiles only samples the job computed do, as a guess or an estimate
+	 * there depends on which worker got to the pixel first. When the job
+	 * estimates distances those must be inside the set too, so that the
+	 * pixel does not go without its exterior disk either way
+	 */
+	static bool shared(Tile const &tile, int x, int y, Sample *sample)
+	{
+		if(owns(tile, x, y))
+		{
+			*sample = buffer::sample(x, y);
+			return !needs_work(*sample);
+		}
+		if(computed[y * job.width + x].load(std::memory_order_acquire) != job.generation)
+			return false;
+
+		*sample = buffer::sample(x, y);
+		return !job.estimate || sample->iter >= job.iterations;
+	}
+
+	/* Computes those of the given pixels that still need work, at most a
+	 * batch of them. Pixels with a symmetric image on screen are computed
+	 * as that image, or take its sample where it can stand in for them.
+	 * Images in the tile are given the sample as well, those in tiles of
+	 * other workers are left to them. Exterior disks are filled around the
+	 * pixels of the tile, mirrored along with their images
+	 */
+	static void compute(Tile const &tile, int const *xs, int const *ys, int n)
+	{
+		int      x_image[BATCH_SIZE];
+		int      y_image[BATCH_SIZE];
+		double   x_point[BATCH_SIZE];
+		double   y_point[BATCH_SIZE];
+		int      index[BATCH_SIZE];
+		Sample   samples[BATCH_SIZE];
+		Estimate estimates[BATCH_SIZE];
+		int      m = 0, mirrored = 0, filled = 0;
+
+		for(int i = 0; i < n; ++i)
+		{
+			int    x, y;
+			Sample sample;
+			if(!needs_work(buffer::sample(xs[i], ys[i])))
+				continue;
+
+			image(xs[i], ys[i], &x, &y);
+			if((x != xs[i] || y != ys[i]) && shared(tile, x, y, &sample))
+			{
+				buffer::set(xs[i], ys[i], sample);
+				mirrored++;
+				continue;
+			}
+			x_image[m] = x, x_point[m] = x;
+			y_image[m] = y, y_point[m] = y;
+			index[m++] = i;
+		}
+
+		long long const executed = compute_points(x_point, y_point, m, samples, estimates);
+
+		int top = job.height, bottom = 0;
+		for(int i = 0; i < m; ++i)
+		{
+			int const  x     = xs[index[i]];
+			int const  y     = ys[index[i]];
+			bool const apart = x != x_image[i] || y != y_image[i];
+
+			if(apart && owns(tile, x_image[i], y_image[i]) && needs_work(buffer::sample(x_image[i], y_image[i])))
+			{
+				set_computed(x_image[i], y_image[i], samples[i]);
+				mirrored++;
+				top    = std::min(top, y_image[i]);
+				bottom = std::max(bottom, y_image[i] + 1);
+			}
+			set_computed(x, y, samples[i]);
+			top    = std::min(top, y);
+			bottom = std::max(bottom, y + 1);
+		}
+		for(int i = 0; i < m; ++i)
+		{
+			if(estimates[i].radius >= 1.0f)
+			{
+				int const x = xs[index[i]];
+				int const y = ys[index[i]];
+				Estimate  estimate = estimates[i];
+				if(x != x_image[i])
+					estimate.slope_x = -estimate.slope_x;
+				if(y != y_image[i])
+					estimate.slope_y = -estimate.slope_y;
+
+				filled += fill_disk(tile, x, y, samples[i], estimate);
+				top     = std::min(top, y - DISK_RADIUS);
+				bottom  = std::max(bottom, y + DISK_RADIUS + 1);
+			}
+		}
+		buffer::touch(top, bottom);
+		stats::computed(m, executed);
+		stats::mirrored(mirrored);
+		stats::filled(filled);
+	}
+
+	/* Computes the given pixels of a row
+	 */
+	static void compute_row(Tile const &tile, int y, int const *xs, int n)
+	{
+		int ys[BATCH_SIZE];
+
+		for(int i = 0; i < n; ++i)
+			ys[i] = y;
+		compute(tile, xs, ys, n);
+	}
+
+	/* Computes the pixels of a rectangle outline (or cross) through the
+	 * corners x0, y0 and x1, y1, with either pair of edges left out
+	 */
+	static void compute_lines(Tile const &tile, int x0, int y0, int x1, int y1, bool rows, bool columns)
+	{
+		int xs[BATCH_SIZE];
+		int ys[BATCH_SIZE];
+		int n = 0;
+
+		for(int x = x0; x <= x1 && rows; ++x)
+		{
+			xs[n] = x, ys[n++] = y0;
+			if(y1 != y0)
+				xs[n] = x, ys[n++] = y1;
+		}
+		for(int y = y0 + 1; y < y1 && columns; ++y)
+		{
+			xs[n] = x0, ys[n++] = y;
+			if(x1 != x0)
+				xs[n] = x1, ys[n++] = y;
+		}
+		compute(tile, xs, ys, n);
+	}
+
+	/* Shows a computed sample on the rest of its block as a preview, until
+	 * finer passes get to those pixels
+	 */
+	static void fill_block(Tile const &tile, int x, int y, int step, Sample sample)
+	{
+		int const x_end = std::min(x + step, tile.x + tile.width);
+		int const y_end = std::min(y + step, tile.y + tile.height);
+
+		for(int j = y; j < y_end; ++j)
+		{
+			for(int i = x; i < x_end; ++i)
+			{
+				if((i != x || j != y) && needs_work(buffer::sample(i, j)))
+					buffer::set(i, j, sample.preview());
+			}
+		}
+	}
+
+	/* Solid guessing: a pixel new to this pass can take the colour of the
+	 * samples of the previous (twice as coarse) pass around it, if every
+	 * block it borders on has the same colour on all of its corners
+	 */
+	static bool guess(int x, int y, int step, Sample *guessed)
+	{
+		int const coarse = step * 2;
+		int const x_odd  = (x - origin_x + TILE_SIZE) % coarse;
+		int const y_odd  = (y - origin_y + TILE_SIZE) % coarse;
+		int const x_from = x_odd ? x - step : x - coarse;
+		int const y_from = y_odd ? y - step : y - coarse;
+		int const x_to   = x_odd ? x + step : x + coarse;
+		int const y_to   = y_odd ? y + step : y + coarse;
+
+		if(x_from < 0 || y_from < 0 || x_to >= job.width || y_to >= job.height)
+			return false;
+
+		Sample const sample = buffer::sample(x_from, y_from);
+		if(needs_work(sample))
+			return false;
+
+		for(int j = y_from; j <= y_to; j += coarse)
+		{
+			for(int i = x_from; i <= x_to; i += coarse)
+			{
+				if(buffer::sample(i, j) != sample)
+					return false;
+			}
+		}
+
+		*guessed = sample;
+		return true;
+	}
+
+	/* One pass of the progressive strategy over a tile, computing the pixels
+	 * on a lattice of the given step that were not on the lattice of the
+	 * previous pass. The lattice is aligned to the tile grid. A single pass
+	 * with a step of 1 renders the full tile
+	 */
+	static void process_pass(Tile const &tile, int step, bool first)
+	{
+		int       xs[TILE_SIZE];
+		int const x0 = tile.x + ((origin_x - tile.x) % step + step) % step;
+		int const y0 = tile.y + ((origin_y - tile.y) % step + step) % step;
+
+		for(int y = y0; y < tile.y + tile.height; y += step)
+		{
+			if(generation != job.generation)
+				return;
+
+			int n = 0, guessed = 0;
+			for(int x = x0; x < tile.x + tile.width; x += step)
+			{
+				if(!first && (x - origin_x + TILE_SIZE) % (step * 2) == 0 && (y - origin_y + TILE_SIZE) % (step * 2) == 0)
+					continue;
+
+				Sample sample = buffer::sample(x, y);
+				if(needs_work(sample) && !first && guess(x, y, step, &sample))
+				{
+					buffer::set(x, y, sample);
+					guessed++;
+				}
+
+				if(!needs_work(sample))
+					fill_block(tile, x, y, step, sample);
+				else
+					xs[n++] = x;
+			}
+
+			compute_row(tile, y, xs, n);
+			for(int i = 0; i < n; ++i)
+			{
+				fill_block(tile, xs[i], y, step, buffer::sample(xs[i], y));
+			}
+			buffer::touch(y, std::min(y + step, tile.y + tile.height));
+			stats::guessed(guessed);
+		}
+	}
+
+	/* Mariani-Silver subdivision of a rectangle whose border has been
+	 * computed. A border of a single colour is filled inwards, otherwise the
+	 * rectangle is split in four along a computed cross
+	 */
+	static void subdivide(Tile const &tile, int x0, int y0, int x1, int y1)
+	{
+		if(generation != job.generation || x1 - x0 < 2 || y1 - y0 < 2)
+			return;
+
+		Sample const sample  = buffer::sample(x0, y0);
+		bool      uniform = !needs_work(sample);
+		for(int x = x0; x <= x1 && uniform; ++x)
+		{
+			uniform = buffer::sample(x, y0) == sample && buffer::sample(x, y1) == sample;
+		}
+		for(int y = y0 + 1; y < y1 && uniform; ++y)
+		{
+			uniform = buffer::sample(x0, y) == sample && buffer::sample(x1, y) == sample;
+		}
+
+		if(uniform)
+		{
+			int filled = 0;
+			for(int y = y0 + 1; y < y1; ++y)
+			{
+				for(int x = x0 + 1; x < x1; ++x)
+				{
+					if(needs_work(buffer::sample(x, y)))
+					{
+						buffer::set(x, y, sample);
+						filled++;
+					}
+				}
+			}
+			buffer::touch(y0 + 1, y1);
+			stats::guessed(filled);
+			return;
+		}
+
+		if(x1 - x0 <= SUBDIVIDE_MIN || y1 - y0 <= SUBDIVIDE_MIN)
+		{
+			int xs[BATCH_SIZE];
+			for(int y = y0 + 1; y < y1; ++y)
+			{
+				int n = 0;
+				for(int x = x0 + 1; x < x1; ++x)
+					xs[n++] = x;
+				compute_row(tile, y, xs, n);
+			}
+			return;
+		}
+
+		// Split along a cross through the middle, both of its lines
+		// are computed in one batch
+		int const xm = (x0 + x1) / 2;
+		int const ym = (y0 + y1) / 2;
+		compute_lines(tile, x0 + 1, ym, x1 - 1, ym, true, false);
+		compute_lines(tile, xm, y0, xm, y1, false, true);
+
+		subdivide(tile, x0, y0, xm, ym);
+		subdivide(tile, xm, y0, x1, ym);
+		subdivide(tile, x0, ym, xm, y1);
+		subdivide(tile, xm, ym, x1, y1);
+	}
+
+	/* Computes the border of a tile and subdivides it
+	 */
+	static void process_subdivide(Tile const &tile)
+	{
+		int const x0 = tile.x, x1 = tile.x + tile.width  - 1;
+		int const y0 = tile.y, y1 = tile.y + tile.height - 1;
+
+		compute_lines(tile, x0, y0, x1, y1, true, true);
+		subdivide(tile, x0, y0, x1, y1);
+	}
+
+	/* A hash of a supersample of a pixel to jitter it by, in [0, 1)
+	 */
+	static double jitter(int x, int y, int k)
+	{
+		unsigned hash = (unsigned)x * 0x9e3779b1u ^ (unsigned)y * 0x85ebca77u ^ (unsigned)k * 0xc2b2ae3du;
+		hash ^= hash >> 16;
+		hash *= 0x7feb352du;
+		hash ^= hash >> 15;
+		return (hash >> 8) * 0x1p-24;
+	}
+
+	/* Whether a pixel is on the shallow side of a sharp edge with one of
+	 * its four neighbours: the border of the set, different periods
+	 * inside it or a step of the palette outside. Only one side of an
+	 * edge is supersampled, which halves the cost and still blends it
+	 */
+	static bool on_edge(int x, int y)
+	{
+		int const    neighbours[4][2] = {{x - 1, y}, {x + 1, y}, {x, y - 1}, {x, y + 1}};
+		Sample const sample           = buffer::sample(x, y);
+		bool const   inside           = sample.iter >= job.iterations;
+
+		for(int i = 0; i < 4; ++i)
+		{
+			int const nx = neighbours[i][0];
+			int const ny = neighbours[i][1];
+			if(nx < 0 || nx >= job.width || ny < 0 || ny >= job.height)
+				continue;
+
+			Sample const neighbour = buffer::sample(nx, ny);
+			if(neighbour.iter < sample.iter || (neighbour.iter == sample.iter && neighbour.value <= sample.value))
+				continue;
+			if(inside || neighbour.iter >= job.iterations || (neighbour.iter - sample.iter) + (neighbour.value - sample.value) >= contrast)
+				return true;
+		}
+		return false;
+	}
+
+	/* Computes SUPERSAMPLES jittered samples of each of the given pixels,
+	 * one in every quarter of the pixel. The jitter is a hash of the pixel
+	 * so that rendering a view again does not shimmer. Returns false once
+	 * the buffer has no room left for supersamples
+	 */
+	static bool supersample(int const *xs, int const *ys, int n)
+	{
+		double    x_point[BATCH_SIZE];
+		double    y_point[BATCH_SIZE];
+		Sample    samples[BATCH_SIZE];
+		int       kept = 0;
+
+		if(n == 0)
+			return true;
+
+		for(int i = 0; i < n; ++i)
+		{
+			for(int k = 0; k < SUPERSAMPLES; ++k)
+			{
+				int const j = i * SUPERSAMPLES + k;
+				x_point[j] = xs[i] + ((k % 2) + jitter(xs[i], ys[i], 2 * k)) / 2 - 0.5;
+				y_point[j] = ys[i] + ((k / 2) + jitter(xs[i], ys[i], 2 * k + 1)) / 2 - 0.5;
+			}
+		}
+
+		long long const executed = compute_points(x_point, y_point, n * SUPERSAMPLES, samples, nullptr);
+		for(int i = 0; i < n && buffer::supersample(xs[i], ys[i], samples + i * SUPERSAMPLES); ++i)
+			kept++;
+		if(kept > 0)
+			buffer::touch(ys[0], ys[kept - 1] + 1);
+		stats::supersampled(kept, executed);
+		return kept == n;
+	}
+
+	/* The last pass when anti-aliasing: supersamples the pixels of a tile
+	 * on edges, unless they already are. Flat regions keep their single
+	 * sample. Returns whether every edge of the tile got its supersamples
+	 */
+	static bool process_edges(Tile const &tile)
+	{
+		int xs[EDGE_BATCH];
+		int ys[EDGE_BATCH];
+		int n = 0;
+
+		for(int y = tile.y; y < tile.y + tile.height; ++y)
+		{
+			if(generation != job.generation)
+				return false;
+
+			for(int x = tile.x; x < tile.x + tile.width; ++x)
+			{
+				if(buffer::supersampled(x, y) || !on_edge(x, y))
+					continue;
+
+				xs[n] = x, ys[n++] = y;
+				if(n == EDGE_BATCH)
+				{
+					if(!supersample(xs, ys, n))
+						return false;
+					n = 0;
+				}
+			}
+		}
+		return supersample(xs, ys, n) && generation == job.generation;
+	}
+
+	/* Processes a tile of the job (for the current pass) with the strategy
+	 * of the job and writes to video buffer. The tile is abandoned as soon
+	 * as a newer job is dispatched. Returns whether the tile got through
+	 * the pass
+	 */
+	static bool process_tile(Tile const &tile)
+	{
+		if(pass == renders)
+			return process_edges(tile);
+
+		switch(job.strategy)
+		{
+		case Strategy::PROGRESSIVE:
+			process_pass(tile, PROGRESSIVE_STEP >> pass, pass == 0);
+			break;
+		case Strategy::SUBDIVIDE:
+			process_subdivide(tile);
+			break;
+		default:
+			process_pass(tile, 1, true);
+			break;
+		}
+		return generation == job.generation;
+	}
+
+	/* Records a tile the current pass went through, once it is through
+	 * the last render pass or had its edges supersampled
+	 */
+	static void settle(int tile)
+	{
+		if(pass == renders - 1)
+			rendered[tile] = true;
+		else if(pass == renders)
+			smoothed[tile] = true;
+	}
+
+	/* A number type is exact enough as long as a pixel spans a few hundred
+	 * units in its last place of the largest coordinate on screen
+	 */
+	template <typename T>
+	static bool resolves(View const &view)
+	{
+		long double extent = std::fmax(view.width, view.height) / (2.0L * view.scale);
+		long double limit  = std::fmax(std::fabs((long double)view.x), std::fabs((long double)view.y)) + extent;
+
+		return 1.0L / view.scale > std::fmax(limit, 2.0L) * (long double)std::numeric_limits<T>::epsilon() * 256;
+	}
+
+	/* Picks the cheapest number type that resolves the pixels of a view.
+	 * The float kernels count iterations in float, which is only exact up
+	 * to 2^24. Views deeper than double-double resolves are rendered by
+	 * perturbation, where the formula allows it, and are left to
+	 * double-double otherwise
+	 */
+	static Precision select_precision(View const &view)
+	{
+		if(resolves<float>(view) && view.iterations < (1 << FLT_MANT_DIG))
+			return Precision::SINGLE;
+		if(resolves<double>(view))
+			return Precision::DOUBLE;
+		if(resolves<long double>(view))
+			return Precision::EXTENDED;
+		if(resolves<DoubleDouble>(view) || !fractal::formula(view.fractal).perturbation)
+			return Precision::PAIRS;
+		return Precision::PERTURBATION;
+	}
+
+	/* Twice the offset of a coordinate from the origin in pixels, if it is
+	 * a whole number and the image of the screen across the origin
+	 * overlaps the screen
+	 */
+	static bool doubled(Fixed const &coordinate, long double scale, int extent, int *twice)
+	{
+		long double const offset = 2.0L * scale * std::fabs((long double)coordinate);
+
+		if(coordinate == Fixed(0))
+		{
+			*twice = 0;
+			return true;
+		}
+		if(offset >= 2.0L * extent || 2.0L * scale >= 0x1p62L)
+			return false;
+
+		Fixed const product = coordinate * Fixed(2.0L * scale);
+		if(!product.integral())
+			return false;
+		*twice = (int)(long double)product;
+		return true;
+	}
+
+	/* The symmetries of the fractal of a view that map its pixel grid onto
+	 * itself. A pixel x, y is mirrored about the real axis onto x, sy - y
+	 * and rotated about the origin onto sx - x, sy - y
+	 */
+	static int symmetric(View const &view, int *sx, int *sy)
+	{
+		int const symmetry = fractal::symmetry(view.fractal, view.variable);
+		int       twice_x, twice_y;
+
+		if(symmetry == fractal::Symmetry::ASYMMETRIC || !doubled(view.y, view.scale, view.height, &twice_y))
+			return fractal::Symmetry::ASYMMETRIC;
+		*sy = 2 * (view.height / 2) + twice_y;
+
+		if(!(symmetry & fractal::Symmetry::ROTATION) || !doubled(view.x, view.scale, view.width, &twice_x))
+			return symmetry & fractal::Symmetry::CONJUGATE;
+		*sx = 2 * (view.width / 2) - twice_x;
+		return symmetry;
+	}
+
+	/* Jobs can be cached if the scale is a power of two and the view centre
+	 * lies on a pixel of that level, which has to be addressable in 64 bits.
+	 * So does the scale, even with the centre at the origin
+	 */
+	static bool cacheable(View const &view, int *level)
+	{
+		long double const extent = std::fmax(std::fabs((long double)view.x), std::fabs((long double)view.y));
+		int exponent;
+
+		if(view.scale >= 0x1p62L || std::frexp(view.scale, &exponent) != 0.5L || extent * view.scale >= 0x1p62L)
+			return false;
+		*level = exponent - 1;
+
+		return (view.x * Fixed(view.scale)).integral() && (view.y * Fixed(view.scale)).integral();
+	}
+}
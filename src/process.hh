@@ -1,16 +1,41 @@
-/* process.hh*/
-#ifndef PROCESS_HH
-#define PROCESS_HH
-
-#define VALUE_INVALID 0x0
-
-namespace process 
-{
-	void await(void);
-	void dispatch(void);
-	void setup_threads(void);
-	void mark(int, int, int);
-	void invalidate(void);
-}
-
-#endif /* PROCESS_HH */
+/* process.hh*/
+#ifndef PROCESS_HH
+#define PROCESS_HH
+
+#define STRATEGIES 3
+#define PRECISIONS 5
+
+enum Strategy : int
+{
+	RASTER      = 0, /* Every pixel in a single pass */
+	PROGRESSIVE = 1, /* Coarse to fine passes with solid guessing */
+	SUBDIVIDE   = 2, /* Mariani-Silver rectangle subdivision */
+};
+
+/* Number types the pixels of a view are computed in, cheapest first
+ */
+enum class Precision : int
+{
+	SINGLE       = 0, /* float */
+	DOUBLE       = 1, /* double */
+	EXTENDED     = 2, /* long double */
+	PAIRS        = 3, /* double-double */
+	PERTURBATION = 4, /* double offsets from a fixed-point reference orbit */
+};
+
+namespace process 
+{
+	Precision precision(void);
+	int iterations(void);
+	char const *precision_name(Precision);
+	void await(void);
+	bool rendering(void);
+	void cancel(void);
+	void dispatch(void);
+	void setup_threads(void);
+	void quit(void);
+	void mark(int, int, int);
+	void invalidate(void);
+}
+
+#endif /* PROCESS_HH */
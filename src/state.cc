@@ -1,97 +1,149 @@
-/* state.cc */
-#include <cstdio>
-#include "state.hh"
-#include "fractal.hh"
-
-#define MAX(x, y) ((x) > (y) ? (x) : (y))
-#define MIN(x, y) ((x) < (y) ? (x) : (y))
-
-#define THREADS_FACTOR    4
-#define ITERATIONS_FACTOR 2
-#define MOVEMENT_FACTOR   16   
-#define SCALE_FACTOR      2
-
-State::State(void)
-{
-	this->x           = 0.0L;
-	this->y           = 0.0L;
-	this->scale       = 128;
-	this->threads     = 4;
-	this->width       = 768;
-	this->height      = 768;
-	this->fractal     = 0;
-	this->iterations  = 256;
-	this->variable    = 0;
-	this->color       = 0;
-	this->status      = Status::CLEAR | Status::SETUP_THREADS | Status::DISPATCH;
-	this->running     = true;
-}
-
-void State::move(int dx, int dy)
-{
-	this->x += (long double)(dx * MOVEMENT_FACTOR) / this->scale;
-	this->y += (long double)(dy * MOVEMENT_FACTOR) / this->scale;
-}
-
-void State::zoom(int signum)
-{
-	if(signum > 0)
-		this->scale *= SCALE_FACTOR;
-	else if(signum < 0)
-		this->scale /= SCALE_FACTOR;
-
-	this->scale = MAX(this->scale, MIN_SCALE);	
-	this->scale = MIN(this->scale, MAX_SCALE);
-}
-
-void State::switch_threads(int signum)
-{
-	if(signum > 0)
-		this->threads *= THREADS_FACTOR;
-	else if(signum < 0)
-		this->threads /= THREADS_FACTOR;
-
-	this->threads = MAX(this->threads, MIN_THREADS);
-	this->threads = MIN(this->threads, MAX_THREADS);
-}
-
-void State::switch_fractal(int signum)
-{
-	if(signum > 0)
-		this->fractal++;
-	else if(signum < 0)
-		this->fractal--;
-	this->fractal %= FRACTALS;
-}
-
-void State::switch_iterations(int signum)
-{
-	if(signum > 0)
-		this->iterations *= ITERATIONS_FACTOR;
-	else if(signum < 0)
-		this->iterations /= ITERATIONS_FACTOR;
-	
-	this->iterations = MAX(this->iterations, MIN_ITERATIONS);
-	this->iterations = MIN(this->iterations, MAX_ITERATIONS);
-}
-
-void State::switch_variable(int signum)
-{
-
-}
-
-void State::switch_color(int signum)
-{
-
-}
-
-void State::set_status(int status)
-{
-	this->status |= status;
-
-}
-
-void State::clear_status(int status)
-{
-	this->status &= ~status;
-}
+/* state.cc */
+#include <cstdio>
+#include <cmath>
+#include <thread>
+#include "state.hh"
+#include "fractal.hh"
+#include "functions.hh"
+#include "process.hh"
+
+#define MAX(x, y) ((x) > (y) ? (x) : (y))
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+
+#define THREADS_FACTOR    2
+#define ITERATIONS_FACTOR 2
+#define MOVEMENT_FACTOR   16   
+#define SCALE_FACTOR      2
+
+State::State(void)
+{
+	this->x           = 0.0L;
+	this->y           = 0.0L;
+	this->scale       = 128.0L;
+	this->threads     = MIN(MAX((int)std::thread::hardware_concurrency(), MIN_THREADS), MAX_THREADS);
+	this->width       = 768;
+	this->height      = 768;
+	this->fractal     = 0;
+	this->iterations  = 256;
+	this->variable    = 0;
+	this->color       = 0;
+	this->strategy    = Strategy::PROGRESSIVE;
+	this->estimate    = false;
+	this->antialias   = false;
+	this->cache       = CACHE_BUDGET;
+	this->status      = Status::CLEAR | Status::SETUP_THREADS | Status::DISPATCH;
+	this->running     = true;
+}
+
+View State::view(unsigned generation) const
+{
+	View view;
+	view.x          = this->x;
+	view.y          = this->y;
+	view.scale      = this->scale;
+	view.width      = this->width;
+	view.height     = this->height;
+	view.fractal    = this->fractal;
+	view.iterations = this->iterations;
+	view.variable   = this->variable;
+	view.strategy   = this->strategy;
+	view.estimate   = this->estimate;
+	view.antialias  = this->antialias;
+	view.color      = this->color;
+	view.generation = generation;
+	return view;
+}
+
+void State::move(int dx, int dy)
+{
+	this->x += (long double)(dx * MOVEMENT_FACTOR) / this->scale;
+	this->y += (long double)(dy * MOVEMENT_FACTOR) / this->scale;
+}
+
+void State::zoom(int signum)
+{
+	if(signum > 0)
+		this->scale *= SCALE_FACTOR;
+	else if(signum < 0)
+		this->scale /= SCALE_FACTOR;
+
+	this->scale = MAX(this->scale, MIN_SCALE);	
+	this->scale = MIN(this->scale, MAX_SCALE);
+
+	/* Zooming out can leave the centre between two pixels, snapping it
+	 * back keeps the view on the tile grid of the cache, as far as the
+	 * grid is addressable
+	 */
+	if(this->scale < 0x1p62L && std::fmax(std::fabs((long double)this->x), std::fabs((long double)this->y)) * this->scale < 0x1p62L)
+	{
+		this->x = std::round((long double)(this->x * Fixed(this->scale))) / this->scale;
+		this->y = std::round((long double)(this->y * Fixed(this->scale))) / this->scale;
+	}
+}
+
+void State::switch_threads(int signum)
+{
+	if(signum > 0)
+		this->threads *= THREADS_FACTOR;
+	else if(signum < 0)
+		this->threads /= THREADS_FACTOR;
+
+	this->threads = MAX(this->threads, MIN_THREADS);
+	this->threads = MIN(this->threads, MAX_THREADS);
+}
+
+/* Every fractal starts out at its first variant
+ */
+void State::switch_fractal(int signum)
+{
+	this->fractal  = (this->fractal + FRACTALS + signum) % FRACTALS;
+	this->variable = 0;
+}
+
+void State::switch_iterations(int signum)
+{
+	if(signum > 0)
+		this->iterations = this->iterations > MAX_ITERATIONS / ITERATIONS_FACTOR ? MAX_ITERATIONS : this->iterations * ITERATIONS_FACTOR;
+	else if(signum < 0)
+		this->iterations /= ITERATIONS_FACTOR;
+	
+	this->iterations = MAX(this->iterations, MIN_ITERATIONS);
+	this->iterations = MIN(this->iterations, MAX_ITERATIONS);
+}
+
+void State::switch_variable(int signum)
+{
+	int const variants = fractal::formula(this->fractal).variants;
+	this->variable = (this->variable + variants + signum) % variants;
+}
+
+void State::switch_color(int signum)
+{
+	this->color = (this->color + COLORS + signum) % COLORS;
+}
+
+void State::switch_strategy(int signum)
+{
+	this->strategy = (this->strategy + STRATEGIES + signum) % STRATEGIES;
+}
+
+void State::switch_estimate(void)
+{
+	this->estimate = !this->estimate;
+}
+
+void State::switch_antialias(void)
+{
+	this->antialias = !this->antialias;
+}
+
+void State::set_status(int status)
+{
+	this->status |= status;
+
+}
+
+void State::clear_status(int status)
+{
+	this->status &= ~status;
+}
@@ -1,55 +1,89 @@
-/* state.hh */
-#ifndef STATE_HH
-#define STATE_HH
-
-#define PROGRAM  "Mandelfract"
-#define VERSION  "1.5.1"
-#define MAX_THREADS    256
-#define MIN_THREADS    1
-#define MAX_ITERATIONS (~(1 << 31))
-#define MIN_ITERATIONS 1
-#define MAX_SCALE      (~(1L << 63))
-#define MIN_SCALE      1
-
-enum Status : int
-{
-	NONE              = 0x00, /* Nothing to be done */
-	DISPATCH_AWAIT    = 0x01, /* Await exit of processing thread(s) */
-	SETUP_THREADS     = 0x02, /* Assign area of screen to processing thread(s) */
-	DISPATCH          = 0x04, /* Dispatch processing threads and start rendering */
-	RESIZE            = 0x08, /* Resize the window and update all relevant variables */
-	TOGGLE_FULLSCREEN = 0x10, /* Toggle fullscreen */
-	SHIFT             = 0x20, /* Perform a video buffer shift */
-	CLEAR             = 0x40, /* Mark every pixel as invalid */
-};
-
-struct State
-{
-	long double x;          /* Camera positon x */
-	long double y;          /* Camera position y */
-	long long   scale;      /* Zoom level */
-	int         threads;    /* Amount of threads rendering */ 
-	int         width;      /* Window width */
-	int         height;     /* Window height */
-	int         fractal;    /* Fractal index */
-	int         iterations; /* Maximum iterations generating the fractal */
-	int         variable;   /* Fractal specific options */
-	int         color;      /* Type of color scheme */
-	int         status;     /* Status flag */
-	bool        running;    /* Global running flag */
-
-	State(void);
-	void move(int, int);
-	void zoom(int);
-	void switch_threads(int);
-	void switch_fractal(int);
-	void switch_iterations(int);
-	void switch_variable(int);
-	void switch_color(int);
-	void set_status(int);
-	void clear_status(int = 0xffffffff);
-};
-
-extern State state;
-
-#endif /* STATE_HH */
+/* state.hh */
+#ifndef STATE_HH
+#define STATE_HH
+
+#include <climits>
+#include "fixed.hh"
+
+#define PROGRAM  "Mandelfract"
+#define VERSION  "1.5.1"
+#define MAX_THREADS    256
+#define MIN_THREADS    1
+#define MAX_ITERATIONS (INT_MAX - 1) /* Previews of interior pixels stay apart from SAMPLE_INVALID */
+#define MIN_ITERATIONS 1
+#define MAX_SCALE      0x1p1000L
+#define MIN_SCALE      1
+#define CACHE_BUDGET   256 /* Default tile cache size in MiB */
+#define COLORS         8   /* Color densities */
+
+enum Status : int
+{
+	NONE              = 0x00, /* Nothing to be done */
+	DISPATCH_AWAIT    = 0x01, /* Cancel the render and await exit of processing thread(s) */
+	SETUP_THREADS     = 0x02, /* Assign area of screen to processing thread(s) */
+	DISPATCH          = 0x04, /* Dispatch processing threads and start rendering */
+	RESIZE            = 0x08, /* Resize the window and update all relevant variables */
+	TOGGLE_FULLSCREEN = 0x10, /* Toggle fullscreen */
+	SHIFT             = 0x20, /* Perform a video buffer shift */
+	CLEAR             = 0x40, /* Mark every pixel as invalid */
+	REPROJECT         = 0x80, /* Carry the video buffer over a zoom */
+};
+
+/* Snapshot of everything a render depends on, taken when it is dispatched
+ * so that the workers never see the state change underneath them
+ */
+struct View
+{
+	Fixed       x;          /* Camera positon x */
+	Fixed       y;          /* Camera position y */
+	long double scale;      /* Zoom level, pixels per unit */
+	int         width;      /* Render width */
+	int         height;     /* Render height */
+	int         fractal;    /* Fractal index */
+	int         iterations; /* Maximum iterations generating the fractal */
+	int         variable;   /* Fractal specific options */
+	int         strategy;   /* Rendering strategy */
+	bool        estimate;   /* Fill the exterior from distance estimates */
+	bool        antialias;  /* Supersample the pixels on edges */
+	int         color;      /* Color density, the palette repeats 2^color times */
+	unsigned    generation; /* Dispatch this view belongs to */
+};
+
+struct State
+{
+	Fixed       x;          /* Camera positon x */
+	Fixed       y;          /* Camera position y */
+	long double scale;      /* Zoom level, pixels per unit */
+	int         threads;    /* Amount of threads rendering */ 
+	int         width;      /* Window width */
+	int         height;     /* Window height */
+	int         fractal;    /* Fractal index */
+	int         iterations; /* Maximum iterations generating the fractal */
+	int         variable;   /* Fractal specific options */
+	int         color;      /* Color density, the palette repeats 2^color times */
+	int         strategy;   /* Rendering strategy */
+	bool        estimate;   /* Fill the exterior from distance estimates */
+	bool        antialias;  /* Supersample the pixels on edges */
+	int         cache;      /* Tile cache budget in MiB */
+	int         status;     /* Status flag */
+	bool        running;    /* Global running flag */
+
+	State(void);
+	View view(unsigned) const;
+	void move(int, int);
+	void zoom(int);
+	void switch_threads(int);
+	void switch_fractal(int);
+	void switch_iterations(int);
+	void switch_variable(int);
+	void switch_color(int);
+	void switch_strategy(int);
+	void switch_estimate(void);
+	void switch_antialias(void);
+	void set_status(int);
+	void clear_status(int = 0xffffffff);
+};
+
+extern State state;
+
+#endif /* STATE_HH */
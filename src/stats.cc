@@ -0,0 +1,267 @@
+/* stats.cc */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <pthread.h>
+#include "stats.hh"
+
+#define TRACE_EVENTS 0x100000 /* Most events a trace holds before it drops them */
+#define MAIN_THREAD  0        /* Trace thread of the main loop, workers follow */
+
+namespace stats
+{
+	/* A complete event of the trace, on the main thread or a worker */
+	struct Event
+	{
+		char const *name;
+		int         thread;
+		double      start;
+		double      duration;
+		int         x, y;
+		int         width, height;
+		int         pass;
+	};
+
+	static auto const             epoch = std::chrono::steady_clock::now();
+
+	/* Counters of the current frame, written by the workers */
+	static std::atomic<double>    start{0.0};
+	static std::atomic<double>    first{0.0};
+	static std::atomic<double>    finish{0.0};
+	static std::atomic<long long> pixels{0};
+	static std::atomic<long long> computed_pixels{0};
+	static std::atomic<long long> guessed_pixels{0};
+	static std::atomic<long long> mirrored_pixels{0};
+	static std::atomic<long long> filled_pixels{0};
+	static std::atomic<long long> supersampled_pixels{0};
+	static std::atomic<long long> iterations{0};
+	static std::atomic<int>       threads{0};
+	static std::atomic<double>    busy[MAX_THREADS];
+
+	/* Presentation of the last frame, written by the main loop only */
+	static double                 paint  = 0.0;
+	static double                 upload = 0.0;
+
+	static std::atomic<bool>      recording{false};
+	static std::vector<Event>     events;
+	static pthread_mutex_t        lock = PTHREAD_MUTEX_INITIALIZER;
+
+	static void record(Event const &);
+
+	double now(void)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch).count();
+	}
+
+	/* Starts a frame of the given amount of pixels rendered by the given
+	 * amount of workers. Called while no worker holds a tile
+	 */
+	void begin(int frame_pixels, int frame_threads)
+	{
+		start               = now();
+		first               = 0.0;
+		finish              = 0.0;
+		pixels              = frame_pixels;
+		computed_pixels     = 0;
+		guessed_pixels      = 0;
+		mirrored_pixels     = 0;
+		filled_pixels       = 0;
+		supersampled_pixels = 0;
+		iterations          = 0;
+		threads             = frame_threads;
+		for(int i = 0; i < frame_threads; ++i)
+			busy[i] = 0.0;
+	}
+
+	void complete(void)
+	{
+		finish = now();
+		record({"frame", MAIN_THREAD, start, finish - start, 0, 0, 0, 0, 0});
+	}
+
+	/* A worker finished a tile (of a pass) it started at the given time
+	 */
+	void tile(int worker, double from, int x, int y, int width, int height, int pass)
+	{
+		double const duration = now() - from;
+		double       total    = busy[worker].load(std::memory_order_relaxed);
+
+		busy[worker].store(total + duration, std::memory_order_relaxed);
+		record({"tile", MAIN_THREAD + 1 + worker, from, duration, x, y, width, height, pass});
+	}
+
+	void computed(int count, long long executed)
+	{
+		double expected = 0.0;
+		if(count == 0)
+			return;
+
+		computed_pixels.fetch_add(count, std::memory_order_relaxed);
+		iterations.fetch_add(executed, std::memory_order_relaxed);
+		if(first.load(std::memory_order_relaxed) == 0.0)
+			first.compare_exchange_strong(expected, now());
+	}
+
+	void guessed(int count)
+	{
+		if(count != 0)
+			guessed_pixels.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	void mirrored(int count)
+	{
+		if(count != 0)
+			mirrored_pixels.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	void filled(int count)
+	{
+		if(count != 0)
+			filled_pixels.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	/* Pixels given supersamples, whose iterations count as work too, even
+	 * those of supersamples there was no room left to keep
+	 */
+	void supersampled(int count, long long executed)
+	{
+		if(count != 0)
+			supersampled_pixels.fetch_add(count, std::memory_order_relaxed);
+		if(executed != 0)
+			iterations.fetch_add(executed, std::memory_order_relaxed);
+	}
+
+	/* The main loop starts presenting a frame that has rows to paint
+	 */
+	void present(void)
+	{
+		paint  = 0.0;
+		upload = 0.0;
+	}
+
+	/* Something the main loop did since the given time, the colouring
+	 * passes and texture uploads of the frame presented are also summed
+	 * up for the overlay
+	 */
+	void span(char const *name, double from)
+	{
+		double const duration = now() - from;
+
+		if(std::strcmp(name, "paint") == 0)
+			paint += duration;
+		else if(std::strcmp(name, "upload") == 0)
+			upload += duration;
+		record({name, MAIN_THREAD, from, duration, 0, 0, 0, 0, 0});
+	}
+
+	/* Copies the counters of the current frame, only the main loop may
+	 * call this as it also reads the presentation timings
+	 */
+	void snapshot(Frame *frame)
+	{
+		frame->start        = start;
+		frame->first        = first;
+		frame->complete     = finish;
+		frame->paint        = paint;
+		frame->upload       = upload;
+		frame->pixels       = pixels;
+		frame->computed     = computed_pixels;
+		frame->guessed      = guessed_pixels;
+		frame->mirrored     = mirrored_pixels;
+		frame->filled       = filled_pixels;
+		frame->supersampled = supersampled_pixels;
+		frame->iterations   = iterations;
+		frame->threads      = threads;
+		for(int i = 0; i < frame->threads; ++i)
+			frame->busy[i] = busy[i];
+	}
+
+	bool tracing(void)
+	{
+		return recording;
+	}
+
+	/* Starts recording events, dropping those of an earlier trace
+	 */
+	void trace_begin(void)
+	{
+		pthread_mutex_lock(&lock);
+		events.clear();
+		recording = true;
+		pthread_mutex_unlock(&lock);
+	}
+
+	/* Stops recording and writes the events as a Chrome trace, which can
+	 * be opened in chrome://tracing or Perfetto
+	 */
+	bool trace_end(char const *path)
+	{
+		pthread_mutex_lock(&lock);
+		recording = false;
+		std::vector<Event> trace;
+		trace.swap(events);
+		pthread_mutex_unlock(&lock);
+
+		FILE *file = std::fopen(path, "w");
+		if(file == NULL)
+			return false;
+
+		int workers = 0;
+		for(Event const &event : trace)
+			workers = std::max(workers, event.thread);
+
+		// Thread names first, then the events in the order they ended
+		bool valid = std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n") > 0;
+		for(int i = 0; i <= workers && valid; ++i)
+		{
+			char name[32] = "main";
+			if(i != MAIN_THREAD)
+				std::snprintf(name, sizeof(name), "worker %d", i - MAIN_THREAD - 1);
+
+			valid = std::fprintf
+			(
+				file,
+				"%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}\n",
+				i == 0 ? "" : ",",
+				i,
+				name
+			) > 0;
+		}
+		for(std::size_t i = 0; i < trace.size() && valid; ++i)
+		{
+			Event const &event = trace[i];
+			valid = std::fprintf
+			(
+				file,
+				",{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+				"\"args\":{\"x\":%d,\"y\":%d,\"width\":%d,\"height\":%d,\"pass\":%d}}\n",
+				event.name,
+				event.thread,
+				event.start * 1e6,
+				event.duration * 1e6,
+				event.x,
+				event.y,
+				event.width,
+				event.height,
+				event.pass
+			) > 0;
+		}
+		valid = valid && std::fprintf(file, "]}\n") > 0;
+
+		return std::fclose(file) == 0 && valid;
+	}
+
+	static void record(Event const &event)
+	{
+		if(!recording.load(std::memory_order_relaxed))
+			return;
+
+		pthread_mutex_lock(&lock);
+		if(recording && events.size() < TRACE_EVENTS)
+			events.push_back(event);
+		pthread_mutex_unlock(&lock);
+	}
+}
@@ -0,0 +1,50 @@
+/* stats.hh */
+#ifndef STATS_HH
+#define STATS_HH
+
+#include "state.hh"
+
+/* Timings and counters of the frame being rendered, for the debug overlay
+ * and for trace files. A frame starts when a job is dispatched and is
+ * complete once its last tile is done; abandoned frames never complete.
+ * Times are in seconds since the program started
+ */
+namespace stats
+{
+	struct Frame
+	{
+		double    start;             /* Dispatch of the job */
+		double    first;             /* First pixel computed, 0 if none yet */
+		double    complete;          /* Last tile done, 0 while rendering */
+		double    paint;             /* Colouring of the last frame presented, over all its runs of rows */
+		double    upload;            /* Texture upload of the last frame presented, likewise */
+		long long pixels;            /* Pixels of the frame */
+		long long computed;          /* Pixels run through a fractal */
+		long long guessed;           /* Pixels filled in by guessing */
+		long long mirrored;          /* Pixels given the sample of a symmetric one */
+		long long filled;            /* Pixels filled in from distance estimates */
+		long long supersampled;      /* Pixels on edges given supersamples */
+		long long iterations;        /* Iterations the kernels ran, of every sample computed */
+		int       threads;           /* Workers rendering the frame */
+		double    busy[MAX_THREADS]; /* Time each worker spent on tiles */
+	};
+
+	double now(void);
+	void   begin(int, int);
+	void   complete(void);
+	void   tile(int, double, int, int, int, int, int);
+	void   computed(int, long long);
+	void   guessed(int);
+	void   mirrored(int);
+	void   filled(int);
+	void   supersampled(int, long long);
+	void   present(void);
+	void   span(char const *, double);
+	void   snapshot(Frame *);
+
+	bool   tracing(void);
+	void   trace_begin(void);
+	bool   trace_end(char const *);
+}
+
+#endif /* STATS_HH */